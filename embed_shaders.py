@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+
+### Writes every shaders/**/*.glsl into a C++ header, see the embed_shaders
+### option. Paths are stored relative to the project root, the way
+### ShaderManager is given them (shaders/util/sdf.glsl). The depfile lists
+### the shaders and their directories, so adding a shader reruns it too.
+###
+### Usage: embed_shaders.py ROOT OUTPUT DEPFILE
+
+import glob
+import os
+import sys
+
+
+def depfile_path(path):
+    return path.replace('\\', '/').replace(' ', '\\ ')
+
+
+def literal(line):
+    escaped = line.replace('\\', '\\\\').replace('"', '\\"')
+    return '"' + escaped + '\\n"'
+
+
+def main():
+    root, output, depfile = sys.argv[1], sys.argv[2], sys.argv[3]
+    shader_dir = os.path.join(root, 'shaders')
+    shaders = sorted(glob.glob(os.path.join(shader_dir, '**', '*.glsl'), recursive=True))
+    dirs = sorted(glob.glob(os.path.join(shader_dir, '**', ''), recursive=True))  # With shaders/ itself.
+
+    out = [
+        '// Generated by embed_shaders.py, do not edit.',
+        '#ifndef CSCI_4110U_EMBEDDED_SHADERS_H',
+        '#define CSCI_4110U_EMBEDDED_SHADERS_H',
+        '',
+        '#include <string_view>',
+        '',
+        'struct EmbeddedShader {',
+        '  std::string_view path;',
+        '  std::string_view source;',
+        '};',
+        '',
+        'inline constexpr EmbeddedShader embedded_shaders[] = {',
+    ]
+    for shader in shaders:
+        path = os.path.relpath(shader, root).replace(os.sep, '/')
+        with open(shader, encoding='utf-8') as file:
+            lines = file.read().split('\n')
+        if lines[-1] == '':
+            lines.pop()
+        out.append('  {"' + path + '",')
+        # One literal per line, long raw strings hit compiler limits (MSVC).
+        out.extend('    ' + literal(line) for line in lines)
+        if not lines:
+            out.append('    ""')
+        out.append('  },')
+    out += ['};', '', '#endif', '']
+
+    with open(output, 'w', encoding='utf-8', newline='\n') as file:
+        file.write('\n'.join(out))
+    with open(depfile, 'w', encoding='utf-8', newline='\n') as file:
+        deps = [os.path.normpath(path) for path in dirs + shaders]
+        file.write(depfile_path(output) + ': ' + ' '.join(depfile_path(dep) for dep in deps) + '\n')
+
+
+if __name__ == '__main__':
+    main()
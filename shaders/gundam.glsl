@@ -1,44 +1,14 @@
 #version 330
 
-/***** Constants *****/
-const int   MAX_ITERATIONS = 128;
-const float EPS            = 0.001;
-const float CAM_DEP        = 1.5;  // Near "plane" is 1.5 units from the camera
-const float FAR            = 20.0;
-const float UNKNOWN_MAT    = 0.0; // Material ID of unknown/no object
-const float PI             = 3.1415;
-const float TAU            = 6.2831;
-
-const vec3 UP = vec3(0.0, 1.0, 0.0);
-/***** Constants *****/
-
-/***** Uniforms *****/
-uniform vec3  imouse;  // .x/.y is mouse coord, .z is 1 or 0 if mouse left is down/up
-uniform vec3  iresolution;
-uniform float itime;
-uniform float itime_delta;
-/***** Uniforms *****/
-
-/***** SDF Declarations *****/
-float sdfOpExtrude(in vec3 point, in float d, in float amount);
-vec3 sdfOpTwistY(in vec3 point, in float amount);
-vec2 sdfOpRepeat2D(in vec2 point, in vec2 scale);
-vec2 sdfOpRepeat2DClamped(in vec2 point, in vec2 scale, in vec2 limit);
+#include "util/common.glsl"
+#include "util/sdf-decl.glsl"
+
 float sdfOpSmoothMin(in float a, in float b, in float k) {
     k *= 4.0;
     float h = max( k-abs(a-b), 0.0 )/k;
     return min(a,b) - h*h*k*(1.0/4.0);
 };
 
-float sdfSphere(in vec3 point, in float radius);
-float sdfBox(in vec3 point, in vec3 half_size);
-float sdfHorseshoe2D(in vec2 point, in vec2 curve, in float inner_radius, in vec2 arm_dimensions);
-float sdfCutSphere(in vec3 point, in float radius, in float height);
-float sdfVerticalCapsule(in vec3 point, in float height, in float offset);
-float sdfCone(in vec3 point, in vec2 cs_angle, in float height);
-float sdfVesica2D(vec2 p, float r, float d);
-/***** SDF Declarations *****/
-
 vec3 pcg3d(vec3 seed) {
     uvec3 v = uvec3(seed);
     v = v * 1664525u + 1013904223u;   
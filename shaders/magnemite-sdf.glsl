@@ -0,0 +1,208 @@
+#version 330
+
+// Generated from src/magnemite_sdf.hpp by final-sdfgen, do not edit.
+
+#include "util/common.glsl"
+#include "util/sdf-decl.glsl"
+
+vec2 scene(in vec3 point) {
+    float u0 = itime * 3.1415;
+    float u1 = u0 / 2.0;
+    float u2 = sin(u1);
+    float u3 = -0.5 * u2;
+    float u4 = sign(u2);
+    float u5 = max(u4, 0.0);
+    float u6 = u3 * u5;
+    float u7 = itime / 2.0;
+    float u8 = floor(u7);
+    float u9 = mod(u8, 2.0);
+    float u10 = itime * 2.0;
+    float u11 = u10 * 3.1415;
+    float u12 = sin(u11);
+    float u13 = u9 * u12;
+    float u14 = -u13;
+    float u15 = cos(u11);
+    float u16 = u9 * u15;
+    float u17 = 1.0 - u9;
+    float u18 = u16 + u17;
+    float u19 = sin(u10);
+    float u20 = u19 * 0.1;
+    float u21 = u20 * u18;
+    float u22 = u20 * u13;
+    float u86 = sin(u7);
+    float u87 = u86 * u86;
+    float u125 = itime / 200.0;
+    float u126 = -itime;
+    float u127 = u126 / 100.0;
+    vec3 p23 = vec3(u18 * point.x + u13 * point.y + u22, u14 * point.x + u18 * point.y + u21, point.z + u6);
+    float d24 = sdfSphere(p23, 0.15);
+    vec2 r25 = vec2(d24, 1.0);
+    if (r25.x - 1.0 < 0.0) {
+        vec3 p26 = p23;
+        p26.x = abs(p23.x);
+        vec3 p27 = p26 - vec3(0.22, 0.0, 0.0);
+        vec3 p28 = vec3(-p27.y, p27.x, p27.z);
+        float d29 = sdfHorseshoe2D(p28.xy, vec2(4.6328703e-05, 1.0), 0.05, vec2(0.1, 0.02));
+        float d30 = sdfOpExtrude(p28, d29, 0.02);
+        vec3 p31 = p23;
+        p31.x = abs(p23.x);
+        if (p23.x > 0.0) p31.y = -p31.y;
+        vec3 p32 = p31 - vec3(0.34, 0.05, 0.0);
+        float d33 = sdfBox(p32, vec3(0.02, 0.02, 0.02));
+        vec3 p34 = p31 - vec3(0.34, -0.05, 0.0);
+        float d35 = sdfBox(p34, vec3(0.02, 0.02, 0.02));
+        vec2 r36 = d35 < d33 ? vec2(d35, 4.0) : vec2(d33, 3.0);
+        vec2 r37 = r36.x < d30 ? r36 : vec2(d30, 2.0);
+        vec3 p38 = sdfOpTwistY(p23, 100.0);
+        vec3 p39 = p38 - vec3(0.0, 0.185, 0.0);
+        float d40 = sdfBox(p39, vec3(0.02, 0.045, 0.02));
+        float d41 = d40 - 0.002;
+        vec3 p42 = p23 - vec3(0.0, 0.16000001, 0.0);
+        float d43 = sdfCutSphere(p42, 0.1, 0.08);
+        float d44 = d43 - 0.003;
+        float d45 = min(d41, d44);
+        vec3 p46 = p23 - vec3(0.0, 0.25, 0.0);
+        float d47 = sdfBox(p46, vec3(0.04, 0.013, 0.013));
+        float d48 = sdfBox(p46, vec3(0.013, 0.013, 0.04));
+        float d49 = min(d47, d48);
+        float d50 = max(-d49, d45);
+        vec2 r51 = d50 < r37.x ? vec2(d50, 5.0) : r37;
+        vec3 p52 = p23 - vec3(-0.05, 0.0, -0.02);
+        vec3 p53 = vec3(0.923884 * p52.x + 0.38267273 * p52.z, -0.35355198 * p52.x + -0.38263 * p52.y + 0.853578 * p52.z, 0.14642206 * p52.x + -0.9239017 * p52.y + -0.35350573 * p52.z);
+        vec3 p54 = sdfOpTwistY(p53, 100.0);
+        vec3 p55 = p54 - vec3(0.0, 0.17, 0.0);
+        float d56 = sdfBox(p55, vec3(0.012, 0.030000001, 0.012));
+        float d57 = d56 - 0.002;
+        vec3 p58 = p53 - vec3(0.0, 0.125, 0.0);
+        float d59 = sdfCutSphere(p58, 0.09, 0.08);
+        float d60 = d59 - 0.003;
+        float d61 = min(d57, d60);
+        vec3 p62 = p53 - vec3(0.0, 0.215, 0.0);
+        float d63 = sdfBox(p62, vec3(0.03, 0.013, 0.01));
+        float d64 = sdfBox(p62, vec3(0.01, 0.013, 0.03));
+        float d65 = min(d63, d64);
+        float d66 = max(-d65, d61);
+        vec2 r67 = d66 < r51.x ? vec2(d66, 5.0) : r51;
+        vec3 p68 = p23 - vec3(0.05, 0.0, -0.02);
+        vec3 p69 = vec3(0.923884 * p68.x + -0.38267273 * p68.z, 0.35355198 * p68.x + -0.38263 * p68.y + 0.853578 * p68.z, -0.14642206 * p68.x + -0.9239017 * p68.y + -0.35350573 * p68.z);
+        vec3 p70 = sdfOpTwistY(p69, 100.0);
+        vec3 p71 = p70 - vec3(0.0, 0.17, 0.0);
+        float d72 = sdfBox(p71, vec3(0.012, 0.030000001, 0.012));
+        float d73 = d72 - 0.002;
+        vec3 p74 = p69 - vec3(0.0, 0.125, 0.0);
+        float d75 = sdfCutSphere(p74, 0.09, 0.08);
+        float d76 = d75 - 0.003;
+        float d77 = min(d73, d76);
+        vec3 p78 = p69 - vec3(0.0, 0.215, 0.0);
+        float d79 = sdfBox(p78, vec3(0.03, 0.013, 0.01));
+        float d80 = sdfBox(p78, vec3(0.01, 0.013, 0.03));
+        float d81 = min(d79, d80);
+        float d82 = max(-d81, d77);
+        vec2 r83 = d82 < r67.x ? vec2(d82, 5.0) : r67;
+        if (r83.x < r25.x) r25 = r83;
+    }
+    float d84 = fract(point.y);
+    vec3 p85 = point;
+    p85.x -= -d84 * d84 * d84 * u87;
+    vec3 p88 = vec3(0.3846154 * p85.x + -0.9230769 * p85.z, p85.y, 0.9230769 * p85.x + 0.3846154 * p85.z);
+    vec3 p89 = p88;
+    p89.xz = sdfOpRepeat2D(p89.xz, vec2(0.8, 0.8));
+    vec3 p90 = p89 - vec3(0.0, -0.8, 0.0);
+    vec3 p91 = p90;
+    p91.xz = sdfOpRepeat2DClamped(p91.xz, vec2(0.1, 0.1), vec2(1.0, 1.0));
+    float d92 = sdfVesica2D(p91.xy, 0.5, 0.707);
+    float d93 = d92 - 0.25;
+    float d94 = sdfOpExtrude(p91, d93, 0.02);
+    vec3 p95 = p90;
+    p95.x = abs(p90.x);
+    vec3 p96 = p95 - vec3(0.19, 0.0, 0.0);
+    float d97 = sdfVesica2D(p96.xy, 0.5, 0.707);
+    float d98 = d97 - 0.25;
+    float d99 = sdfOpExtrude(p96, d98, 0.02);
+    float d100 = min(d94, d99);
+    vec3 p101 = p90;
+    p101.z = abs(p90.z);
+    vec3 p102 = p101 - vec3(0.0, 0.0, 0.19);
+    float d103 = sdfVesica2D(p102.xy, 0.5, 0.707);
+    float d104 = d103 - 0.25;
+    float d105 = sdfOpExtrude(p102, d104, 0.02);
+    float d106 = min(d100, d105);
+    vec2 r107 = d106 < r25.x ? vec2(d106, 6.0) : r25;
+    vec2 r108 = vec2(3.4028235e+38, UNKNOWN_MAT);
+    if (point.z < -2.0) {
+        vec3 p109 = point - vec3(0.0, -0.8, 0.0);
+        vec3 p110 = p109 * 0.5;
+        vec3 p111 = p110;
+        p111.xz = sdfOpRepeat2D(p111.xz, vec2(0.8, 0.8));
+        vec3 p112 = p111 - vec3(0.0, 0.45, 0.0);
+        float d113 = sdfCone(p112, vec2(0.8314535, 0.5555943), 0.25);
+        vec3 p114 = p112 - vec3(0.0, 0.06666667, 0.0);
+        float d115 = sdfCone(p114, vec2(0.8314535, 0.5555943), 0.2);
+        vec3 p116 = p114 - vec3(0.0, 0.05, 0.0);
+        float d117 = sdfCone(p116, vec2(0.8314535, 0.5555943), 0.15);
+        float d118 = min(d115, d117);
+        float d119 = min(d113, d118);
+        float d120 = sdfVerticalCapsule(p111, 0.2, 0.05);
+        vec2 r121 = d120 < d119 ? vec2(d120, 7.0) : vec2(d119, 8.0);
+        float d122 = r121.x / 0.5;
+        r108 = vec2(d122, r121.y);
+    }
+    vec2 r123 = r108.x < r107.x ? r108 : r107;
+    vec2 r124 = vec2(3.4028235e+38, UNKNOWN_MAT);
+    if (point.y > 0.6) {
+        vec3 p128 = point - vec3(u127, 1.0, u125);
+        vec3 p129 = p128;
+        p129.xz = sdfOpRepeat2D(p129.xz, vec2(3.0, 3.0));
+        float d130 = sdfBox(p129, vec3(0.2, 0.03, 0.1));
+        float d131 = d130 - 0.02;
+        r124 = vec2(d131, 9.0);
+    }
+    vec2 r132 = r124.x < r123.x ? r124 : r123;
+    float d133 = point.y - -0.8;
+    vec2 r134 = d133 < r132.x ? vec2(d133, 10.0) : r132;
+    return r134;
+}
+
+vec3 sceneColor(float id, vec3 point) {
+    float u0 = itime * 3.1415;
+    float u1 = u0 / 2.0;
+    float u2 = sin(u1);
+    float u3 = -0.5 * u2;
+    float u4 = sign(u2);
+    float u5 = max(u4, 0.0);
+    float u6 = u3 * u5;
+    float u7 = itime / 2.0;
+    float u8 = floor(u7);
+    float u9 = mod(u8, 2.0);
+    float u10 = itime * 2.0;
+    float u11 = u10 * 3.1415;
+    float u12 = sin(u11);
+    float u13 = u9 * u12;
+    float u14 = -u13;
+    float u15 = cos(u11);
+    float u16 = u9 * u15;
+    float u17 = 1.0 - u9;
+    float u18 = u16 + u17;
+    float u19 = sin(u10);
+    float u20 = u19 * 0.1;
+    float u21 = u20 * u18;
+    float u22 = u20 * u13;
+    if (abs(id - 1.0) < 0.5) {
+        vec3 p23 = vec3(u18 * point.x + u13 * point.y + u22, u14 * point.x + u18 * point.y + u21, point.z + u6);
+        float d24 = normalize(p23).z;
+        if (d24 > 0.995) return vec3(0.005, 0.005, 0.005);
+        if (d24 > 0.9) return vec3(0.2, 0.2, 0.2);
+        if (d24 > 0.89) return vec3(0.005, 0.005, 0.005);
+        return vec3(0.05, 0.1, 0.2);
+    }
+    if (abs(id - 2.0) < 0.5) return vec3(0.05, 0.07, 0.1);
+    if (abs(id - 3.0) < 0.5) return vec3(0.15, 0.02, 0.02);
+    if (abs(id - 4.0) < 0.5) return vec3(0.02, 0.02, 0.15);
+    if (abs(id - 5.0) < 0.5) return vec3(0.08, 0.1, 0.12);
+    if (abs(id - 6.0) < 0.5) return vec3(0.04, 0.2, 0.02);
+    if (abs(id - 7.0) < 0.5) return vec3(0.04, 0.03, 0.0);
+    if (abs(id - 8.0) < 0.5) return vec3(0.01, 0.05, 0.01);
+    if (abs(id - 9.0) < 0.5) return vec3(0.3, 0.3, 0.3);
+    if (abs(id - 10.0) < 0.5) return vec3(0.05, 0.07, 0.1);
+    return vec3(1.0, 0.0, 1.0);
+}
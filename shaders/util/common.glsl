@@ -0,0 +1,41 @@
+// Shared by the scene shaders and ray_marcher.glsl through #include, no
+// #version (see ShaderManager::preprocess).
+
+/***** Constants *****/
+// Overridden by quality presets, see ShaderDefines in shader_manager.hpp.
+#ifndef MAX_ITERATIONS
+#define MAX_ITERATIONS 128
+#endif
+#ifndef EPS
+#define EPS 0.001
+#endif
+#ifndef FAR
+#define FAR 20.0
+#endif
+
+const float CAM_DEP        = 1.5;  // Near "plane" is 1.5 units from the camera
+const float UNKNOWN_MAT    = 0.0; // Material ID of unknown/no object
+const float PI             = 3.1415;
+const float TAU            = 6.2831;
+
+const vec3 UP = vec3(0.0, 1.0, 0.0);
+/***** Constants *****/
+
+/***** Uniforms *****/
+// Per-frame inputs, one buffer shared by every scene (FrameUniforms in main.cpp).
+layout(std140) uniform Frame {
+    vec3  imouse;  // .x/.y is mouse coord, .z is 1 or 0 if mouse left is down/up
+    float itime;
+    vec3  iresolution;
+    float itime_delta;
+    int   ianaglyph; // 0 = off, 1 = double render.
+};
+/***** Uniforms *****/
+
+/***** Scene Declarations *****/
+// Defined by the scene.
+vec2 scene(in vec3 point);
+vec3 sceneColor(in float material, in vec3 point);
+// Defined by ray_marcher.glsl.
+vec3 castRay(in vec3 ro, in vec3 rd);
+/***** Scene Declarations *****/
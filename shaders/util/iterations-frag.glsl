@@ -0,0 +1,48 @@
+#version 330
+
+/***** Constants *****/
+#ifndef MAX_ITERATIONS
+#define MAX_ITERATIONS 128
+#endif
+/***** Constants *****/
+
+/***** Uniforms *****/
+uniform usampler2D iterations_texture; // Raw step counts written by ray_marcher.glsl
+/***** Uniforms *****/
+
+/***** Inputs *****/
+in vec2 f_texcoords;
+/***** Inputs *****/
+
+out vec4 frag_color;
+
+vec3 iterationColour(in float iterations) {
+    // Using oklab colour space: https://bottosson.github.io/posts/oklab/
+    // Specifically, this implementation: https://www.shadertoy.com/view/WtccD7
+    const vec3 low_its  = vec3(0.23, 0.191, -0.110);
+    const vec3 high_its = vec3(0.90, 0.000,  0.070);
+
+    const mat3 fwdA = mat3(
+        1.0,           1.0,           1.0,
+        0.3963377774, -0.1055613458, -0.0894841775,
+        0.2158037573, -0.0638541728, -1.2914855480
+    );
+    const mat3 fwdB = mat3(
+         4.0767245293, -1.2681437731, -0.0041119885,
+        -3.3072168827,  2.6093323231, -0.7034763098,
+         0.2307590544, -0.3411344290,  1.7068625689
+    );
+
+    float scale = iterations / MAX_ITERATIONS;
+    vec3 lms = mix(low_its, high_its, scale);
+
+    lms = fwdA * lms;
+    return fwdB * (lms*lms*lms);
+}
+
+void main() {
+    // Integer textures can not be filtered, fetch the texel directly.
+    ivec2 texel = ivec2(f_texcoords * textureSize(iterations_texture, 0));
+    float iterations = float(texelFetch(iterations_texture, texel, 0).r);
+    frag_color = vec4(pow(iterationColour(iterations), vec3(0.4545)), 1.0);
+}
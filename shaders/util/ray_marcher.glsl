@@ -1,35 +1,33 @@
 #version 330
 
+#include "common.glsl"
+
 /***** Constants *****/
-const int   MAX_ITERATIONS = 128;
-const float EPS            = 0.001;
-const float CAM_DEP        = 1.5;  // Near "plane" is 1.5 units from the camera
-const float FAR            = 20.0;
-const float UNKNOWN_MAT    = 0.0; // Material ID of unknown/no object
-const float PI             = 3.1415;
-const float TAU            = 6.2831;
 const int ANAGLYPH_OFF     = 0;
 const int ANAGLYPH_NAIVE   = 1;
 const int ANAGLYPH_DUBOIS  = 2;
 
-const vec3 UP = vec3(0.0, 1.0, 0.0);
+// Permutations, see ShaderDefines in shader_manager.hpp. A constant ANAGLYPH
+// folds away the branches of the other modes.
+#ifndef ITERATION_OUTPUT
+#define ITERATION_OUTPUT 1
+#endif
 /***** Constants *****/
 
-/***** Uniforms *****/
-uniform vec3  imouse;  // .x/.y is mouse coord, .z is 1 or 0 if mouse left is down/up
-uniform vec3  iresolution;
-uniform float itime;
-uniform float itime_delta;
-uniform int ianaglyph; // 0 = off, 1 = double render.
-/***** Uniforms *****/
+#ifndef ANAGLYPH
+#define ANAGLYPH ianaglyph
+#endif
 
-/***** Scene Declarations *****/
-vec2 scene(in vec3 point);
-vec3 sceneColor(in float material, in vec3 point);
-/***** Scene Declarations *****/
+#ifdef PROFILE_SECTIONS
+// Generated by SectionProfiler, see section_profiler.cpp.
+void profileFlush();
+uint profileHeatmap(uint fallback);
+#endif
 
 layout(location = 0) out vec4 frag_colour;
-layout(location = 1) out vec4 iteration_colour;
+#if ITERATION_OUTPUT
+layout(location = 1) out uint iteration_count; // Raw ray march steps, see iterations-frag.glsl
+#endif
 
 // Tetrahedron Technique: https://iquilezles.org/articles/normalsSDF/
 vec3 sceneNormal(in vec3 point) {
@@ -42,30 +40,6 @@ vec3 sceneNormal(in vec3 point) {
                      k.xxx * scene(point + k.xxx*h).x);
 }
 
-vec3 iterationColour(in float iterations) {
-    // Using oklab colour space: https://bottosson.github.io/posts/oklab/
-    // Specifically, this implementation: https://www.shadertoy.com/view/WtccD7
-    const vec3 low_its  = vec3(0.23, 0.191, -0.110);
-    const vec3 high_its = vec3(0.90, 0.000,  0.070);
-
-    const mat3 fwdA = mat3(
-        1.0,           1.0,           1.0,
-        0.3963377774, -0.1055613458, -0.0894841775,
-        0.2158037573, -0.0638541728, -1.2914855480
-    );
-    const mat3 fwdB = mat3(
-         4.0767245293, -1.2681437731, -0.0041119885,
-        -3.3072168827,  2.6093323231, -0.7034763098,
-         0.2307590544, -0.3411344290,  1.7068625689
-    );
-
-    float scale = iterations / MAX_ITERATIONS;
-    vec3 lms = mix(low_its, high_its, scale);
-
-    lms = fwdA * lms;
-    return fwdB * (lms*lms*lms);
-}
-
 vec3 castRay(in vec3 ro, in vec3 rd) {
     float t = 0.0; // Accumulated distance.
     float m = -1.0; // Material ID.
@@ -180,18 +154,18 @@ void main() {
     vec3 colour;
     vec3 ray_info;
 
-    if (ianaglyph == ANAGLYPH_OFF) {
+    if (ANAGLYPH == ANAGLYPH_OFF) {
         render2D(colour, ray_info); // NOTE: colour & ray_info are out variables.
     } else {
         vec3 left_colour;
         vec3 right_colour;
         render3D(left_colour, right_colour, ray_info);
 
-        if (ianaglyph == ANAGLYPH_NAIVE) {
+        if (ANAGLYPH == ANAGLYPH_NAIVE) {
             vec3 left_filter = vec3(1.0, 0.0, 0.0);
             vec3 right_filter = vec3(0.0, 1.0, 1.0);
             colour = left_colour * left_filter + right_colour * right_filter;
-        } else if (ianaglyph == ANAGLYPH_DUBOIS) {
+        } else if (ANAGLYPH == ANAGLYPH_DUBOIS) {
             mat3 lf = mat3(
                  0.4561,     0.500484,   0.176381,
                 -0.400822,  -0.0378246, -0.0157589,
@@ -210,6 +184,12 @@ void main() {
     // Gamma correction. 0.4545 ~standard encoding for computer displays/sRGB.
     colour      = pow(colour, vec3(0.4545));
     frag_colour = vec4(colour, 1);
-    iteration_colour = vec4(pow(iterationColour(ray_info.z), vec3(0.4545)), 1.0);
+#if ITERATION_OUTPUT
+    iteration_count = uint(ray_info.z);
+#endif
+#ifdef PROFILE_SECTIONS
+    profileFlush();
+    iteration_count = profileHeatmap(iteration_count);
+#endif
 }
 
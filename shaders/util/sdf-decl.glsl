@@ -0,0 +1,17 @@
+// Declarations of the functions in sdf.glsl, for #include.
+
+/***** SDF Declarations *****/
+float sdfOpExtrude(in vec3 point, in float d, in float amount);
+vec2 sdfOpRepeatMirroredClamped(in vec2 point, in float scale, in vec2 repititions);
+vec3 sdfOpTwistY(in vec3 point, in float amount);
+vec2 sdfOpRepeat2D(in vec2 point, in vec2 scale);
+vec2 sdfOpRepeat2DClamped(in vec2 point, in vec2 scale, in vec2 limit);
+
+float sdfSphere(in vec3 point, in float radius);
+float sdfBox(in vec3 point, in vec3 half_size);
+float sdfHorseshoe2D(in vec2 point, in vec2 curve, in float inner_radius, in vec2 arm_dimensions);
+float sdfCutSphere(in vec3 point, in float radius, in float height);
+float sdfVerticalCapsule(in vec3 point, in float height, in float offset);
+float sdfCone(in vec3 point, in vec2 cs_angle, in float height);
+float sdfVesica2D(vec2 p, float r, float d);
+/***** SDF Declarations *****/
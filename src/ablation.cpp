@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <spdlog/spdlog.h>
+
+#include "ablation.hpp"
+#include "shader_sections.hpp"
+
+// Value returned by a stubbed function: its first argument of the return
+// type, otherwise a distance far outside the scene.
+static std::string stubValue(const ShaderSection &section) {
+  std::istringstream params{section.params};
+  std::string param;
+  while (std::getline(params, param, ',')) {
+    std::istringstream words{param};
+    std::vector<std::string> tokens;
+    std::string token;
+    while (words >> token) tokens.push_back(token);
+    if (tokens.size() >= 2 && tokens[tokens.size() - 2] == section.return_type) return tokens.back();
+  }
+  return section.return_type + "(1e10)";
+}
+
+static bool ablatable(const ShaderSection &section) {
+  return section.in_function || !section.function.empty();
+}
+
+std::string Ablation::stub(const std::string &source, const std::string &name) {
+  auto lines = splitLines(source);
+  for (auto &section : findSections(lines)) {
+    if (section.name != name || !ablatable(section)) continue;
+
+    // Prepended to the marker lines, line numbers stay the same as in the file.
+    if (section.in_function) {
+      lines[section.begin_line] = "#if 0 " + lines[section.begin_line];
+      lines[section.end_line] = "#endif " + lines[section.end_line];
+      continue;
+    }
+
+    auto body = section.return_type == "void" ? std::string{} : "return " + stubValue(section) + "; ";
+    renameFunction(lines, section, section.function + "_ablated");
+    lines[section.end_line] = section.return_type + " " + section.function + "(" + section.params + ") { "
+                            + body + "} " + lines[section.end_line];
+  }
+  return joinLines(lines);
+}
+
+Ablation::Ablation(ShaderManager &shader_manager, const std::string &scene, BenchOpts opts, float time)
+    : opts(opts), fixed_time(time) {
+  shader_manager.get(scene, {}, true);  // Scenes are compiled on first use.
+  const ShaderProgram &base = shader_manager.getProgram(scene);
+  variants.push_back({.section = {}, .program = scene, .compiled = base.id != 0});
+
+  std::vector<std::string> names;
+  for (auto &shader : base.shaders) {
+    if (shader.type != GL_FRAGMENT_SHADER) continue;
+    auto source = shader.source.empty() ? shader_manager.slurp(shader.path) : shader.source;
+    for (auto &section : findSections(splitLines(source))) {
+      if (!ablatable(section)) continue;
+      if (std::find(names.begin(), names.end(), section.name) == names.end()) names.push_back(section.name);
+    }
+  }
+
+  for (auto &name : names) {
+    ShaderProgram program = base;
+    program.name = scene + "-ablate-" + name;
+    program.id = 0;
+    for (auto &shader : program.shaders) shader.id = 0;
+    program.transform = [name](const Shader &shader, const std::string &source) {
+      return shader.type == GL_FRAGMENT_SHADER ? stub(source, name) : source;
+    };
+
+    shader_manager.compile(program);
+    bool compiled = shader_manager.get(program.name) != 0;
+    if (!compiled) spdlog::warn("Ablation: {} can not be removed on its own, skipped", name);
+    variants.push_back({.section = name, .program = program.name, .compiled = compiled});
+  }
+
+  spdlog::info("Ablation: {} sections at itime {}", names.size(), fixed_time);
+  frame_times.reserve(opts.frames);
+  gpu_times.reserve(opts.frames);
+  current = -1;
+  nextVariant();
+}
+
+void Ablation::nextVariant() {
+  do {
+    current++;
+  } while (!done() && !variants[current].compiled);
+  frame = 0;
+}
+
+void Ablation::addFrame(double frame_ms, double gpu_ms) {
+  if (done()) return;
+
+  if (frame >= opts.warmup_frames) {
+    frame_times.push_back(frame_ms);
+    gpu_times.push_back(gpu_ms);
+  }
+  frame++;
+  if (frame < opts.warmup_frames + opts.frames) return;
+
+  auto &variant = variants[current];
+  variant.frame_ms = FrameTimeStats::from(frame_times);
+  variant.gpu_ms = FrameTimeStats::from(gpu_times);
+  frame_times.clear();
+  gpu_times.clear();
+  spdlog::info("Ablation: {} {:.3f}ms gpu median",
+    variant.section.empty() ? "baseline" : variant.section, variant.gpu_ms.median);
+  nextVariant();
+}
+
+void Ablation::writeReport(const BenchInfo &info) const {
+  std::ofstream out{opts.output};
+  if (!out) {
+    spdlog::error("Ablation: Could not open {} for writing!", opts.output);
+    return;
+  }
+
+  // Deltas use the GPU median, the least noisy of the measurements.
+  const auto &baseline = variants[0];
+  out << "{\n"
+      << "  \"scene\": \"" << info.scene << "\",\n"
+      << "  \"width\": " << info.width << ",\n"
+      << "  \"height\": " << info.height << ",\n"
+      << "  \"anaglyph\": \"" << info.anaglyph << "\",\n"
+      << "  \"renderer\": \"" << info.renderer << "\",\n"
+      << "  \"time\": " << fixed_time << ",\n"
+      << "  \"warmup_frames\": " << opts.warmup_frames << ",\n"
+      << "  \"frames\": " << opts.frames << ",\n"
+      << "  \"baseline\": {"
+      << "\"frame_ms\": " << baseline.frame_ms.mean << ", "
+      << "\"gpu_ms\": " << baseline.gpu_ms.median << "},\n"
+      << "  \"sections\": [";
+  for (size_t i = 1; i < variants.size(); i++) {
+    auto &variant = variants[i];
+    out << (i == 1 ? "\n" : ",\n")
+        << "    {\"section\": \"" << variant.section << "\", "
+        << "\"compiled\": " << (variant.compiled ? "true" : "false");
+    if (variant.compiled) {
+      double delta = baseline.gpu_ms.median - variant.gpu_ms.median;
+      out << ", \"frame_ms\": " << variant.frame_ms.mean
+          << ", \"gpu_ms\": " << variant.gpu_ms.median
+          << ", \"delta_ms\": " << delta
+          << ", \"delta_pct\": " << (baseline.gpu_ms.median > 0.0 ? 100.0 * delta / baseline.gpu_ms.median : 0.0);
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+
+  spdlog::info("Ablation: {} variants -> {}", variants.size() - 1, opts.output);
+}
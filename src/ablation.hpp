@@ -0,0 +1,52 @@
+#ifndef CSCI_4110U_ABLATION_H
+#define CSCI_4110U_ABLATION_H
+
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "shader_manager.hpp"
+
+struct AblationVariant {
+  std::string section;  // Empty for the baseline.
+  std::string program;
+  bool compiled = false;
+  FrameTimeStats frame_ms{};
+  FrameTimeStats gpu_ms{};
+};
+
+/* Section ablation: one build of a scene per `//===== Section: X =====//`
+   block with that block stubbed out, each benchmarked at a fixed time.
+
+   Sections inside a function body are removed with `#if 0`. Sections around
+   a whole function replace it with a stub returning its first argument of
+   the same type (operators become the identity) or a far away distance
+   (the shape disappears). Removing a section that declares a variable used
+   later does not compile, such variants are reported but not measured.
+*/
+class Ablation {
+  BenchOpts opts;
+  float fixed_time;
+  std::vector<AblationVariant> variants{};  // Baseline first.
+  int current = 0;
+  int frame = 0;
+  std::vector<double> frame_times{};
+  std::vector<double> gpu_times{};
+
+  void nextVariant();
+
+  public:
+    Ablation(ShaderManager &shader_manager, const std::string &scene, BenchOpts opts, float time);
+
+    static std::string stub(const std::string &source, const std::string &section);
+
+    // The baseline once done, so that a last frame still has a program.
+    const std::string &program() const { return variants[done() ? 0 : current].program; }
+    float time() const { return fixed_time; }
+    bool done() const { return current >= (int)variants.size(); }
+
+    void addFrame(double frame_ms, double gpu_ms);
+    void writeReport(const BenchInfo &info) const;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+
+#include "bench.hpp"
+
+// Nearest-rank percentile of sorted samples.
+static double percentile(const std::vector<double> &sorted, double p) {
+  size_t rank = (size_t)std::ceil(p * sorted.size());
+  return sorted[std::clamp(rank, (size_t)1, sorted.size()) - 1];
+}
+
+FrameTimeStats FrameTimeStats::from(std::vector<double> samples) {
+  FrameTimeStats stats;
+  if (samples.empty()) return stats;
+
+  std::sort(samples.begin(), samples.end());
+  stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+  stats.median = percentile(samples, 0.50);
+  stats.p95 = percentile(samples, 0.95);
+  stats.p99 = percentile(samples, 0.99);
+  stats.min = samples.front();
+  stats.max = samples.back();
+  return stats;
+}
+
+void writeStats(std::ostream &out, const std::string &name, const FrameTimeStats &stats, const char *indent) {
+  out << indent << "\"" << name << "\": {"
+      << "\"mean\": " << stats.mean << ", "
+      << "\"median\": " << stats.median << ", "
+      << "\"p95\": " << stats.p95 << ", "
+      << "\"p99\": " << stats.p99 << ", "
+      << "\"min\": " << stats.min << ", "
+      << "\"max\": " << stats.max << "}";
+}
+
+Bench::Bench(BenchOpts opts) : opts(opts) {
+  frame_times.reserve(opts.frames);
+  gpu_times.reserve(opts.frames);
+}
+
+void Bench::addFrame(double frame_ms, double gpu_ms) {
+  if (done()) return;
+
+  if (!warmingUp()) {
+    frame_times.push_back(frame_ms);
+    gpu_times.push_back(gpu_ms);
+  }
+  frame++;
+  if (frame < opts.warmup_frames + opts.frames) return;
+
+  // Every config warms up again and renders the same frames.
+  if (!opts.configs.empty()) {
+    config_frame_stats.push_back(FrameTimeStats::from({frame_times.end() - opts.frames, frame_times.end()}));
+    config_gpu_stats.push_back(FrameTimeStats::from({gpu_times.end() - opts.frames, gpu_times.end()}));
+  }
+  current_config++;
+  if (!done()) frame = 0;
+}
+
+void Bench::addIterationStats(double mean, int max, double max_fraction) {
+  if (warmingUp()) return;
+
+  iteration_samples++;
+  iteration_mean_sum += mean;
+  max_fraction_sum += max_fraction;
+  iteration_max = std::max(iteration_max, max);
+}
+
+void Bench::writeReport(const BenchInfo &info) const {
+  auto frame_stats = FrameTimeStats::from(frame_times);
+  auto gpu_stats = FrameTimeStats::from(gpu_times);
+
+  std::ofstream out{opts.output};
+  if (!out) {
+    spdlog::error("Bench: Could not open {} for writing!", opts.output);
+    return;
+  }
+
+  // Strings come from the command line and GL_RENDERER, neither contain
+  // characters that need escaping in practice.
+  out << "{\n"
+      << "  \"scene\": \"" << info.scene << "\",\n"
+      << "  \"width\": " << info.width << ",\n"
+      << "  \"height\": " << info.height << ",\n"
+      << "  \"anaglyph\": \"" << info.anaglyph << "\",\n"
+      << "  \"quality\": \"" << info.quality << "\",\n"
+      << "  \"renderer\": \"" << info.renderer << "\",\n"
+      << "  \"gl_errors\": \"" << info.gl_errors << "\",\n"
+      << "  \"warmup_frames\": " << opts.warmup_frames << ",\n"
+      << "  \"frames\": " << frame_times.size() << ",\n"
+      << "  \"time_step\": " << opts.time_step << ",\n";
+  writeStats(out, "frame_ms", frame_stats);
+  out << ",\n";
+  writeStats(out, "gpu_ms", gpu_stats);
+  if (iteration_samples > 0) {
+    out << ",\n"
+        << "  \"iterations\": {"
+        << "\"frames\": " << iteration_samples << ", "
+        << "\"mean\": " << iteration_mean_sum / iteration_samples << ", "
+        << "\"max\": " << iteration_max << ", "
+        << "\"max_fraction\": " << max_fraction_sum / iteration_samples << "}";
+  }
+  if (!opts.configs.empty()) {
+    out << ",\n  \"configs\": {";
+    for (size_t i = 0; i < config_frame_stats.size(); i++) {
+      out << (i == 0 ? "\n" : ",\n") << "    \"" << opts.configs[i] << "\": {\n";
+      writeStats(out, "frame_ms", config_frame_stats[i], "      ");
+      out << ",\n";
+      writeStats(out, "gpu_ms", config_gpu_stats[i], "      ");
+      out << "\n    }";
+    }
+    out << "\n  }";
+  }
+  out << "\n}\n";
+
+  spdlog::info("Bench: {} frames, frame {:.3f}ms mean / {:.3f}ms p99, gpu {:.3f}ms mean -> {}",
+    frame_times.size(), frame_stats.mean, frame_stats.p99, gpu_stats.mean, opts.output);
+  for (size_t i = 0; i < config_frame_stats.size(); i++) {
+    spdlog::info("  {}: frame {:.3f}ms mean, gpu {:.3f}ms mean",
+      opts.configs[i], config_frame_stats[i].mean, config_gpu_stats[i].mean);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef CSCI_4110U_BENCH_H
+#define CSCI_4110U_BENCH_H
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchOpts {
+  int warmup_frames = 60;
+  int frames = 600;                 // Measured frames, after warmup.
+  float time_step = 1.0f / 60.0f;   // Fixed `itime` step per frame (seconds).
+  std::string output = "bench.json";
+  // Measured one after another with the same frames, e.g. GL error modes.
+  // Empty for a single run.
+  std::vector<std::string> configs{};
+};
+
+/* Describes the run, copied verbatim into the report. */
+struct BenchInfo {
+  std::string scene;
+  int width;
+  int height;
+  std::string anaglyph;
+  std::string quality;
+  std::string renderer;
+  std::string gl_errors;
+};
+
+struct FrameTimeStats {
+  double mean = 0.0;
+  double median = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+
+  static FrameTimeStats from(std::vector<double> samples);
+};
+
+// `"name": {"mean": ..., ...}` without a trailing comma or newline.
+void writeStats(std::ostream &out, const std::string &name, const FrameTimeStats &stats, const char *indent = "  ");
+
+class Bench {
+  BenchOpts opts;
+  int frame = 0;
+  int current_config = 0;
+  std::vector<double> frame_times{};  // Milliseconds.
+  std::vector<double> gpu_times{};    // Milliseconds.
+  std::vector<FrameTimeStats> config_frame_stats{};
+  std::vector<FrameTimeStats> config_gpu_stats{};
+
+  // Ray march step counts, only reported when collected.
+  int iteration_samples = 0;
+  double iteration_mean_sum = 0.0;
+  double max_fraction_sum = 0.0;
+  int iteration_max = 0;
+
+  public:
+    Bench(BenchOpts opts);
+
+    float time() const { return frame * opts.time_step; }
+    float timeStep() const { return opts.time_step; }
+    bool warmingUp() const { return frame < opts.warmup_frames; }
+    bool done() const { return current_config >= std::max((int)opts.configs.size(), 1); }
+    int config() const { return current_config; }
+    int configCount() const { return opts.configs.size(); }
+
+    void addFrame(double frame_ms, double gpu_ms);
+    void addIterationStats(double mean, int max, double max_fraction);
+    void writeReport(const BenchInfo &info) const;
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "bench.hpp"
+#include "cpu_renderer.hpp"
+
+// Same names and presets as main.cpp.
+static const char *scene_names[] = {"gundam", "magnemite", "magnemite-sdf"};
+static const char *mode_3d_names[] = {"none", "naive", "dubois"};
+static const char *quality_names[] = {"low", "medium", "high"};
+static const char *kernel_names[] = {"scalar", "avx2", "avx512"};  // CPU_KERNEL_*
+
+struct QualityLimits {
+  int max_iterations;
+  float eps;
+  float far;
+};
+static const QualityLimits quality_limits[] = {
+  {64, 0.002f, 12.0f},
+  {128, 0.001f, 20.0f},
+  {256, 0.0005f, 30.0f},
+};
+
+static int findName(const char *const *names, int count, const std::string &name) {
+  for (int i = 0; i < count; i++) {
+    if (name == names[i]) return i;
+  }
+  return -1;
+}
+
+// Binary PPM, top row first.
+static bool writeColour(const std::string &path, const CpuImage &image) {
+  std::ofstream out{path, std::ios::binary};
+  if (!out) return false;
+
+  out << "P6\n" << image.width << " " << image.height << "\n255\n";
+  for (int y = image.height - 1; y >= 0; y--) {
+    for (int x = 0; x < image.width; x++) {
+      out.write((const char *)&image.colour[((size_t)y * image.width + x) * 4], 3);
+    }
+  }
+  return (bool)out;
+}
+
+// 16-bit PGM of the step counts (big endian), top row first.
+static bool writeIterations(const std::string &path, const CpuImage &image) {
+  std::ofstream out{path, std::ios::binary};
+  if (!out) return false;
+
+  out << "P5\n" << image.width << " " << image.height << "\n65535\n";
+  for (int y = image.height - 1; y >= 0; y--) {
+    for (int x = 0; x < image.width; x++) {
+      uint16_t steps = image.iterations[(size_t)y * image.width + x];
+      char bytes[2] = {(char)(steps >> 8), (char)(steps & 0xFF)};
+      out.write(bytes, 2);
+    }
+  }
+  return (bool)out;
+}
+
+static double renderMs(const CpuRenderOpts &opts, TaskPool &pool, CpuImage &image) {
+  auto start = std::chrono::steady_clock::now();
+  image = renderCpu(opts, pool);
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Renders the frame `frames` times on pools of 1 to max_threads workers and
+   writes each pool's frame times, speedup over one worker and how evenly
+   its workers were busy, plus the time of every tile. Expensive tiles (the
+   screws, the grass band) show up as a busiest worker well above the mean.
+*/
+static bool writeScaling(const std::string &path, const CpuRenderOpts &opts, int frames, int max_threads) {
+  std::ofstream out{path};
+  if (!out) return false;
+
+  CpuImage image;
+  double single_ms = 0.0;
+  out << "{\n";
+  out << "  \"scene\": \"" << scene_names[opts.scene_id] << "\",\n";
+  out << "  \"width\": " << opts.width << ",\n";
+  out << "  \"height\": " << opts.height << ",\n";
+  out << "  \"tile_size\": " << CPU_TILE_SIZE << ",\n";
+  out << "  \"frames\": " << frames << ",\n";
+  out << "  \"runs\": [\n";
+  for (int threads = 1; threads <= max_threads; threads++) {
+    TaskPool pool{threads};
+    renderMs(opts, pool, image);  // Warm up the threads' buffers.
+    pool.resetStats();
+
+    std::vector<double> frame_ms;
+    for (int frame = 0; frame < frames; frame++) frame_ms.push_back(renderMs(opts, pool, image));
+    FrameTimeStats stats = FrameTimeStats::from(frame_ms);
+    if (threads == 1) single_ms = stats.median;
+
+    auto workers = pool.stats();
+    double busy_sum = 0.0;
+    double busy_max = 0.0;
+    for (auto &worker : workers) {
+      busy_sum += worker.busy_ms;
+      busy_max = std::max(busy_max, worker.busy_ms);
+    }
+    double imbalance = busy_sum > 0.0 ? busy_max / (busy_sum / threads) : 1.0;
+    // Frames too fast for the clock would print nan, which is not JSON.
+    double speedup = stats.median > 0.0 ? single_ms / stats.median : 1.0;
+    spdlog::info("CPU: {} threads {:.2f}ms, {:.2f}x, {:.0f}% efficiency, busiest worker {:.2f}x the mean",
+      threads, stats.median, speedup, 100.0 * speedup / threads, imbalance);
+
+    out << "    {\"threads\": " << threads << ",\n";
+    writeStats(out, "frame_ms", stats, "     ");
+    out << ",\n";
+    out << "     \"speedup\": " << speedup << ", \"efficiency\": " << speedup / threads
+        << ", \"imbalance\": " << imbalance << ",\n";
+    out << "     \"workers\": [";
+    for (size_t i = 0; i < workers.size(); i++) {
+      out << (i ? ", " : "") << "{\"tasks\": " << workers[i].tasks << ", \"steals\": " << workers[i].steals
+          << ", \"busy_ms\": " << workers[i].busy_ms / frames << "}";
+    }
+    out << "]}" << (threads < max_threads ? "," : "") << "\n";
+  }
+  out << "  ],\n";
+  out << "  \"kernel\": \"" << kernel_names[image.kernel] << "\",\n";  // Not always opts.kernel.
+
+  // Tile times of the last frame, top row first like the images.
+  out << "  \"tiles\": {\"x\": " << image.tiles_x << ", \"y\": " << image.tiles_y << ",\n";
+  writeStats(out, "ms", FrameTimeStats::from({image.tile_ms.begin(), image.tile_ms.end()}), "    ");
+  out << ",\n    \"grid_ms\": [\n";
+  for (int y = image.tiles_y - 1; y >= 0; y--) {
+    out << "      [";
+    for (int x = 0; x < image.tiles_x; x++) out << (x ? ", " : "") << image.tile_ms[y * image.tiles_x + x];
+    out << "]" << (y > 0 ? "," : "") << "\n";
+  }
+  out << "    ]\n  }\n}\n";
+  return (bool)out;
+}
+
+static void printUsage() {
+  spdlog::info("Usage: final-cpu [options]");
+  spdlog::info("  --scene NAME           gundam | magnemite | magnemite-sdf");
+  spdlog::info("  --size WxH             Resolution, default 1152x720");
+  spdlog::info("  --anaglyph MODE        none | naive | dubois");
+  spdlog::info("  --quality PRESET       low | medium | high ray march limits");
+  spdlog::info("  --time S               itime in seconds (0)");
+  spdlog::info("  --threads N            Render threads, default every core");
+  spdlog::info("  --kernel NAME          auto | scalar | avx2 | avx512 ray marching");
+  spdlog::info("  --frames N             Render the frame N times and report the time of each (1)");
+  spdlog::info("  --output PATH          Colour output, binary PPM (frame.ppm)");
+  spdlog::info("  --iterations PATH      Ray march step counts, 16-bit PGM");
+  spdlog::info("  --scaling PATH         Time --frames frames on 1 to --threads threads, write JSON");
+}
+
+int main(int argc, char **argv) {
+  auto logger = std::make_shared<spdlog::logger>("logger", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+  spdlog::register_logger(logger);
+  spdlog::set_default_logger(logger);
+
+  CpuRenderOpts opts{};
+  int quality = 1;
+  int frames = 1;
+  std::string output = "frame.ppm";
+  std::string iterations_output{};
+  std::string scaling_output{};
+  int threads = 0;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      bool has_value = i + 1 < argc;
+      if (arg == "--help") {
+        printUsage();
+        return 0;
+      } else if (arg == "--scene" && has_value) {
+        opts.scene_id = findName(scene_names, 3, argv[++i]);
+        if (opts.scene_id < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--anaglyph" && has_value) {
+        opts.frame.anaglyph = findName(mode_3d_names, 3, argv[++i]);
+        if (opts.frame.anaglyph < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--quality" && has_value) {
+        quality = findName(quality_names, 3, argv[++i]);
+        if (quality < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--size" && has_value) {
+        std::string size = argv[++i];
+        auto x = size.find('x');
+        if (x == std::string::npos) throw std::invalid_argument(arg);
+        opts.width = std::stoi(size.substr(0, x));
+        opts.height = std::stoi(size.substr(x + 1));
+        if (opts.width <= 0 || opts.height <= 0) throw std::invalid_argument(arg);
+      } else if (arg == "--time" && has_value) {
+        opts.frame.time = std::stof(argv[++i]);
+      } else if (arg == "--threads" && has_value) {
+        threads = std::stoi(argv[++i]);
+      } else if (arg == "--kernel" && has_value) {
+        std::string kernel = argv[++i];
+        opts.kernel = kernel == "auto" ? CPU_KERNEL_AUTO : findName(kernel_names, 3, kernel);
+        if (kernel != "auto" && opts.kernel < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--frames" && has_value) {
+        frames = std::stoi(argv[++i]);
+        if (frames < 1) throw std::invalid_argument(arg);
+      } else if (arg == "--output" && has_value) {
+        output = argv[++i];
+      } else if (arg == "--iterations" && has_value) {
+        iterations_output = argv[++i];
+      } else if (arg == "--scaling" && has_value) {
+        scaling_output = argv[++i];
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  } catch (std::logic_error &err) {
+    spdlog::error("Invalid argument: {}", err.what());
+    printUsage();
+    return -1;
+  }
+
+  opts.frame.max_iterations = quality_limits[quality].max_iterations;
+  opts.frame.eps = quality_limits[quality].eps;
+  opts.frame.far = quality_limits[quality].far;
+  int best_kernel = cpuBestKernel();
+  if (opts.kernel == CPU_KERNEL_AUTO) {
+    opts.kernel = best_kernel;
+  } else if (opts.kernel > best_kernel) {
+    spdlog::error("CPU: The {} kernel is not supported here, the best is {}!", kernel_names[opts.kernel], kernel_names[best_kernel]);
+    return -1;
+  }
+
+  if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  spdlog::info("CPU: {} {}x{}, anaglyph {}, {} quality, {} threads",
+    scene_names[opts.scene_id], opts.width, opts.height, mode_3d_names[opts.frame.anaglyph], quality_names[quality], threads);
+
+  if (!scaling_output.empty()) {
+    if (!writeScaling(scaling_output, opts, frames, threads)) {
+      spdlog::error("CPU: Could not write {}!", scaling_output);
+      return -1;
+    }
+    spdlog::info("CPU: Wrote {}", scaling_output);
+    return 0;
+  }
+
+  TaskPool pool{threads};
+  CpuImage image;
+  for (int frame = 0; frame < frames; frame++) {
+    double ms = renderMs(opts, pool, image);
+    spdlog::info("CPU: Frame {} {:.2f}ms ({:.2f} Mpixel/s, {} kernel)", frame, ms, opts.width * opts.height / (ms * 1000.0),
+      kernel_names[image.kernel]);
+  }
+
+  if (!writeColour(output, image)) {
+    spdlog::error("CPU: Could not write {}!", output);
+    return -1;
+  }
+  if (!iterations_output.empty() && !writeIterations(iterations_output, image)) {
+    spdlog::error("CPU: Could not write {}!", iterations_output);
+    return -1;
+  }
+  spdlog::info("CPU: Wrote {}{}", output, iterations_output.empty() ? "" : " and " + iterations_output);
+}
@@ -0,0 +1,48 @@
+#ifndef CSCI_4110U_CPU_PACKET_H
+#define CSCI_4110U_CPU_PACKET_H
+
+#include "cpu_scenes.hpp"
+
+// Ray march kernels of the CPU renderer, see renderCpu().
+#define CPU_KERNEL_AUTO -1
+#define CPU_KERNEL_SCALAR 0
+#define CPU_KERNEL_AVX2 1    // 8 rays per packet.
+#define CPU_KERNEL_AVX512 2  // 16 rays per packet.
+
+/* Everything the packet kernels need to know about the frame. Plain floats:
+   the kernels are compiled with their own instruction set flags and must not
+   call glm or anything else inline that the scalar code also uses, see
+   cpu_simd.hpp.
+*/
+struct CpuPacketFrame {
+  int scene_id;  // CPU_SCENE_*
+  int max_iterations;
+  float eps;
+  float far;
+  float time;
+  float sun_dir[3];
+  float magnemite_tx[16];  // Column major, MagnemiteScene::magnemite_tx.
+  float gundam_rot[CPU_GUNDAM_DETAIL][9];  // GundamScene::detail_rot
+  float gundam_offset[CPU_GUNDAM_DETAIL][2];
+};
+
+/* A batch of rays, one array per component. The kernels march them in
+   packets and write what castRay, sceneNormal and the shadow ray of
+   sceneLighting find for each ray; normal and shadow are only written for
+   rays that hit something (material > 0).
+*/
+struct CpuRays {
+  int count;
+  const float *origin[3];
+  const float *dir[3];
+  float *t;
+  float *material;
+  float *steps;
+  float *normal[3];
+  float *shadow;  // sun_sha, 0 in shadow.
+};
+
+void marchRaysAvx2(const CpuPacketFrame &frame, const CpuRays &rays);
+void marchRaysAvx512(const CpuPacketFrame &frame, const CpuRays &rays);
+
+#endif
@@ -0,0 +1,6 @@
+// Built with AVX2 enabled, only called when the CPU has it.
+#include "cpu_packet_kernel.hpp"
+
+void marchRaysAvx2(const CpuPacketFrame &frame, const CpuRays &rays) {
+  marchRays(frame, rays);
+}
@@ -0,0 +1,6 @@
+// Built with AVX-512F enabled, only called when the CPU has it.
+#include "cpu_packet_kernel.hpp"
+
+void marchRaysAvx512(const CpuPacketFrame &frame, const CpuRays &rays) {
+  marchRays(frame, rays);
+}
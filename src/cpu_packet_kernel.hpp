@@ -0,0 +1,469 @@
+#ifndef CSCI_4110U_CPU_PACKET_KERNEL_H
+#define CSCI_4110U_CPU_PACKET_KERNEL_H
+
+#include <math.h>
+
+#include "cpu_packet.hpp"
+#include "cpu_scenes.hpp"
+#include "cpu_simd.hpp"
+
+/* The packet version of cpu_renderer.cpp's RayMarcher and the scenes, one
+   ray per lane. Included once per instruction set by cpu_packet_*.cpp.
+   Branches become masks: a block runs when any lane needs it and only the
+   lanes that would have taken it keep the result. The arithmetic is
+   written in the same order as the scalar port so both give the same
+   image.
+*/
+
+namespace {
+
+struct Vec2N {
+  FloatN x, y;
+};
+
+struct Vec3N {
+  FloatN x, y, z;
+};
+
+inline Vec2N operator-(Vec2N a, Vec2N b) { return {a.x - b.x, a.y - b.y}; }
+inline Vec3N operator+(Vec3N a, Vec3N b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3N operator-(Vec3N a, Vec3N b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3N operator*(Vec3N a, FloatN s) { return {a.x * s, a.y * s, a.z * s}; }
+inline Vec3N operator*(FloatN s, Vec3N a) { return {s * a.x, s * a.y, s * a.z}; }
+
+inline FloatN length(Vec2N a) { return sqrt(a.x * a.x + a.y * a.y); }
+inline FloatN length(Vec3N a) { return sqrt(a.x * a.x + a.y * a.y + a.z * a.z); }
+inline Vec2N max(Vec2N a, FloatN b) { return {max(a.x, b), max(a.y, b)}; }
+inline Vec3N max(Vec3N a, FloatN b) { return {max(a.x, b), max(a.y, b), max(a.z, b)}; }
+inline Vec3N abs(Vec3N a) { return {abs(a.x), abs(a.y), abs(a.z)}; }
+inline Vec3N normalize(Vec3N a) { return a * (1.0f / sqrt(a.x * a.x + a.y * a.y + a.z * a.z)); }
+
+// `if (d < dist) res = vec2(d, id)` of the scenes, for the lanes in `where`.
+inline void closer(FloatN::Mask where, FloatN d, FloatN id, FloatN &dist, FloatN &mat) {
+  FloatN::Mask take = where & (d < dist);
+  dist = select(take, d, dist);
+  mat = select(take, id, mat);
+}
+
+inline void closer(FloatN d, FloatN id, FloatN &dist, FloatN &mat) {
+  FloatN::Mask take = d < dist;
+  dist = select(take, d, dist);
+  mat = select(take, id, mat);
+}
+
+//===== Section: SDFs =====//
+// cpu_sdf.hpp per lane. Sizes are the same for every lane and stay scalar.
+
+inline FloatN sdfOpExtrude(Vec3N point, FloatN d, float amount) {
+  Vec2N w{d, abs(point.z) - amount};
+  return min(max(w.x, w.y), 0.0f) + length(max(w, 0.0f));
+}
+
+// mat3(c, 0, s, 0, 1, 0, -s, 0, c) * point, without the zero terms.
+inline Vec3N sdfOpTwistY(Vec3N point, float amount) {
+  FloatN s, c;
+  sincos(amount * point.y, s, c);
+  return {c * point.x - s * point.z, point.y, s * point.x + c * point.z};
+}
+
+inline Vec2N sdfOpRepeat2D(Vec2N point, float scale_x, float scale_y) {
+  return {point.x - scale_x * round(point.x / scale_x), point.y - scale_y * round(point.y / scale_y)};
+}
+
+inline Vec2N sdfOpRepeat2DClamped(Vec2N point, float scale_x, float scale_y, float limit_x, float limit_y) {
+  return {point.x - scale_x * clamp(round(point.x / scale_x), -limit_x, limit_x),
+          point.y - scale_y * clamp(round(point.y / scale_y), -limit_y, limit_y)};
+}
+
+inline FloatN sdfOpSmoothMin(FloatN a, FloatN b, float k) {
+  k *= 4.0f;
+  FloatN h = max(k - abs(a - b), 0.0f) / k;
+  return min(a, b) - h * h * k * (1.0f / 4.0f);
+}
+
+inline FloatN sdfSphere(Vec3N point, float radius) {
+  return length(point) - radius;
+}
+
+inline FloatN sdfBox(Vec3N point, float half_x, float half_y, float half_z) {
+  Vec3N q = abs(point) - Vec3N{half_x, half_y, half_z};
+  return length(max(q, 0.0f)) + min(max(q.x, max(q.y, q.z)), 0.0f);
+}
+
+inline FloatN sdfHorseshoe2D(Vec2N point, float curve_x, float curve_y, float inner_radius, float arm_x, float arm_y) {
+  point.x = abs(point.x);
+  FloatN l = length(point);
+  point = {-curve_x * point.x + curve_y * point.y, curve_y * point.x + curve_x * point.y};
+  float sign_curve = -curve_x > 0.0f ? 1.0f : -curve_x < 0.0f ? -1.0f : 0.0f;
+  FloatN::Mask x_positive = point.x > 0.0f;
+  point = {select((point.y > 0.0f) | x_positive, point.x, l * sign_curve), select(x_positive, point.y, l)};
+  point = Vec2N{point.x, abs(point.y - inner_radius)} - Vec2N{arm_x, arm_y};
+  return length(max(point, 0.0f)) + min(0.0f, max(point.x, point.y));
+}
+
+inline FloatN sdfCutSphere(Vec3N p, float r, float h) {
+  float w = sqrtf(r * r - h * h);
+
+  Vec2N q{length(Vec2N{p.x, p.z}), p.y};
+  FloatN s = max((h - r) * q.x * q.x + w * w * (h + r - 2.0f * q.y), h * q.x - w * q.y);
+  return select(s < 0.0f, length(q) - r,
+                select(q.x < w, h - q.y, length(q - Vec2N{w, h})));
+}
+
+inline FloatN sdfVerticalCapsule(Vec3N point, float height, float offset) {
+  point.y = point.y - clamp(point.y, 0.0f, height);
+  return length(point) - offset;
+}
+
+inline FloatN sdfCone(Vec3N point, float sc_x, float sc_y, float height) {
+  FloatN q = length(Vec2N{point.x, point.z});
+  return max(sc_x * q + sc_y * point.y, -height - point.y);
+}
+
+inline FloatN sdfVesica2D(Vec2N p, float r, float d) {
+  p = {abs(p.x), abs(p.y)};
+  float b = sqrtf(r * r - d * d);
+  return select((p.y - b) * d > p.x * b, length(p - Vec2N{0.0f, b}),
+                length(p - Vec2N{-d, 0.0f}) - r);
+}
+//===== Section: SDFs =====//
+
+//===== Section: Scenes =====//
+struct GundamPacket {
+  const CpuPacketFrame &frame;
+
+  FloatN detail(FloatN base, Vec3N point) const {
+    FloatN d = base;
+    for (int i = 0; i < CPU_GUNDAM_DETAIL; i++) {
+      const float *rot = frame.gundam_rot[i];  // point * rot
+      point = {point.x * rot[0] + point.y * rot[1] + point.z * rot[2],
+               point.x * rot[3] + point.y * rot[4] + point.z * rot[5],
+               point.x * rot[6] + point.y * rot[7] + point.z * rot[8]};
+
+      Vec3N p = point;
+      p.x = p.x + frame.gundam_offset[i][0];
+      p.z = p.z + frame.gundam_offset[i][1];
+      p.y = p.y + 0.4f;
+      Vec2N xz = sdfOpRepeat2D(Vec2N{p.x, p.z}, 2.0f, 2.0f);
+      p.x = xz.x;
+      p.z = xz.y;
+      FloatN s = sdfSphere(p, 0.4f);
+      d = sdfOpSmoothMin(d, s, 0.1f);
+    }
+    return d;
+  }
+
+  void scene(Vec3N point, FloatN &dist, FloatN &mat) const {
+    float plane_y_pos = -0.8f;
+    dist = point.y - plane_y_pos;
+    mat = 1.0f;
+
+    Vec3N detail_point = point + Vec3N{0.0f, 0.9f, 0.0f};
+    dist = detail(dist, detail_point);
+
+    FloatN box = sdfBox(point, 0.5f, 0.2f, 0.2f);
+    dist = min(box, dist);
+  }
+};
+
+struct MagnemitePacket {
+  const CpuPacketFrame &frame;
+  float arm_curve_c = cosf(CPU_PI / 2);
+  float arm_curve_s = sinf(CPU_PI / 2);
+  float c1 = cosf(CPU_PI * 1 / 8);
+  float s1 = sinf(CPU_PI * 1 / 8);
+  float c5 = cosf(CPU_PI * 5 / 8);
+  float s5 = sinf(CPU_PI * 5 / 8);
+  float leaf_s = sinf(CPU_PI / 3.2f);
+  float leaf_c = cosf(CPU_PI / 3.2f);
+  float bend_factor = sinf(frame.time / 2);
+
+  static FloatN drawGrass(Vec3N point) {
+    point.y = point.y - -0.8f;
+
+    Vec3N point_r = point;
+    Vec2N xz = sdfOpRepeat2DClamped(Vec2N{point_r.x, point_r.z}, 0.1f, 0.1f, 1.0f, 1.0f);
+    point_r.x = xz.x;
+    point_r.z = xz.y;
+    FloatN grass_grouped = sdfVesica2D(Vec2N{point_r.x, point_r.y}, 0.5f, 0.707f) - 0.25f;
+    grass_grouped = sdfOpExtrude(point_r, grass_grouped, 0.02f);
+
+    Vec3N point_h = point;
+    point_h.x = abs(point_h.x) - 0.19f;
+    FloatN grass_h = sdfVesica2D(Vec2N{point_h.x, point_h.y}, 0.5f, 0.707f) - 0.25f;
+    grass_h = sdfOpExtrude(point_h, grass_h, 0.02f);
+
+    Vec3N point_v = point;
+    point_v.z = abs(point_v.z) - 0.19f;
+    FloatN grass_v = sdfVesica2D(Vec2N{point_v.x, point_v.y}, 0.5f, 0.707f) - 0.25f;
+    grass_v = sdfOpExtrude(point_v, grass_v, 0.02f);
+
+    return min(grass_grouped, min(grass_h, grass_v));
+  }
+
+  void drawTree(Vec3N point, FloatN &dist, FloatN &mat) const {
+    float trunk_height = 0.2f;
+    float trunk_radius = 0.05f;
+    float leaf_height = 0.25f;
+
+    FloatN trunk = sdfVerticalCapsule(point, trunk_height, trunk_radius);
+
+    point.y = point.y - (trunk_height + leaf_height);
+    FloatN cone1 = sdfCone(point, leaf_s, leaf_c, leaf_height);
+    leaf_height -= 0.05f;
+    point.y = point.y - leaf_height / 3;
+    FloatN cone2 = sdfCone(point, leaf_s, leaf_c, leaf_height);
+    leaf_height -= 0.05f;
+    point.y = point.y - leaf_height / 3;
+    FloatN cone3 = sdfCone(point, leaf_s, leaf_c, leaf_height);
+    FloatN leaves = min(cone1, min(cone2, cone3));
+
+    FloatN::Mask is_trunk = trunk < leaves;
+    dist = select(is_trunk, trunk, leaves);
+    mat = select(is_trunk, FloatN(7.0f), FloatN(8.0f));
+  }
+
+  static FloatN drawCloud(Vec3N point) {
+    return sdfBox(point, 0.2f, 0.03f, 0.1f) - 0.02f;
+  }
+
+  static FloatN screwBottom(Vec3N screw_p, float body_radius, float screw_twist, float half_x, float half_y, float half_z) {
+    Vec3N screwb_point = sdfOpTwistY(screw_p, screw_twist);
+    screwb_point.y = screwb_point.y - (body_radius + half_y - 0.01f);
+    FloatN screwb_body = sdfBox(screwb_point, half_x, half_y, half_z) - 0.002f;
+
+    Vec3N screwb_head_point = screw_p;
+    screwb_head_point.y = screwb_head_point.y - (body_radius + half_y - 0.055f);
+    FloatN screwb_head = sdfCutSphere(screwb_head_point, 0.09f, 0.08f) - 0.003f;
+
+    screwb_head_point = screw_p;
+    screwb_head_point.y = screwb_head_point.y - 0.215f;
+    FloatN screwb_hole1 = sdfBox(screwb_head_point, 0.030f, 0.013f, 0.010f);
+    FloatN screwb_hole2 = sdfBox(screwb_head_point, 0.010f, 0.013f, 0.030f);
+    FloatN screwb_hole = min(screwb_hole1, screwb_hole2);
+
+    return max(-screwb_hole, min(screwb_body, screwb_head));
+  }
+
+  void scene(Vec3N point, FloatN &dist, FloatN &mat) const {
+    const float *tx = frame.magnemite_tx;  // vec4(point, 1) * magnemite_tx
+    Vec3N magnemite_point{point.x * tx[0] + point.y * tx[1] + point.z * tx[2] + tx[3],
+                          point.x * tx[4] + point.y * tx[5] + point.z * tx[6] + tx[7],
+                          point.x * tx[8] + point.y * tx[9] + point.z * tx[10] + tx[11]};
+
+    float body_radius = 0.15f;
+    FloatN body = sdfSphere(magnemite_point, body_radius);
+    dist = body;
+    mat = 1.0f;
+
+    // Use body as bounding volume
+    FloatN::Mask near = body - 1.0f < 0.0f;
+    if (any(near)) {
+      float arm_radius = 0.05f;
+      float arm_thickness = 0.02f;
+      float arm_length = 0.10f;
+
+      Vec3N arm_point = magnemite_point;
+      arm_point.x = abs(arm_point.x) - (body_radius + arm_radius + arm_thickness);
+      FloatN arms2D = sdfHorseshoe2D(Vec2N{-arm_point.y, arm_point.x}, arm_curve_c, arm_curve_s,
+                                     arm_radius, arm_length, arm_thickness);
+      FloatN arms = sdfOpExtrude(magnemite_point, arms2D, arm_thickness);
+      closer(near, arms, 2.0f, dist, mat);
+
+      Vec3N tips_point = magnemite_point;
+      float tips_half_size = arm_thickness;
+      float tips_offset_x = body_radius + arm_radius + arm_length + (2 * arm_thickness);
+      float tips_offset_y = arm_radius + ((arm_thickness - tips_half_size) / 2);
+      tips_point.x = abs(tips_point.x);
+      tips_point.y = select(magnemite_point.x > 0.0f, -tips_point.y, tips_point.y);
+
+      FloatN tips_red = sdfBox(tips_point - Vec3N{tips_offset_x, tips_offset_y, 0.0f}, tips_half_size, tips_half_size, tips_half_size);
+      closer(near, tips_red, 3.0f, dist, mat);
+
+      FloatN tips_blue = sdfBox(tips_point - Vec3N{tips_offset_x, -tips_offset_y, 0.0f}, tips_half_size, tips_half_size, tips_half_size);
+      closer(near, tips_blue, 4.0f, dist, mat);
+
+      float screw_half_y = body_radius * 0.3f;
+      float screw_twist = 100;
+
+      Vec3N screw_point = sdfOpTwistY(magnemite_point, screw_twist);
+      screw_point.y = screw_point.y - (body_radius + screw_half_y - 0.01f);
+      FloatN screw_body = sdfBox(screw_point, 0.02f, screw_half_y, 0.02f) - 0.002f;
+
+      Vec3N screw_head_point = magnemite_point;
+      screw_head_point.y = screw_head_point.y - (body_radius + screw_half_y - 0.035f);
+      FloatN screw_head = sdfCutSphere(screw_head_point, 0.1f, 0.08f) - 0.003f;
+
+      screw_head_point = magnemite_point;
+      screw_head_point.y = screw_head_point.y - 0.25f;
+      FloatN screw_hole1 = sdfBox(screw_head_point, 0.040f, 0.013f, 0.013f);
+      FloatN screw_hole2 = sdfBox(screw_head_point, 0.013f, 0.013f, 0.040f);
+      FloatN screw_hole = min(screw_hole1, screw_hole2);
+
+      FloatN screw_top = max(-screw_hole, min(screw_body, screw_head));
+      closer(near, screw_top, 5.0f, dist, mat);
+
+      // The tilt and the two turns about y of MagnemiteScene, without the
+      // zero terms.
+      float screwb_half_y = body_radius * 0.2f;
+      Vec3N screw_p = magnemite_point - Vec3N{-body_radius / 3, 0.0f, -0.02f};
+      screw_p = {c1 * screw_p.x + s1 * screw_p.z, screw_p.y, -s1 * screw_p.x + c1 * screw_p.z};
+      screw_p = {screw_p.x, c5 * screw_p.y + s5 * screw_p.z, -s5 * screw_p.y + c5 * screw_p.z};
+      FloatN screwb_top = screwBottom(screw_p, body_radius, screw_twist, 0.012f, screwb_half_y, 0.012f);
+      closer(near, screwb_top, 5.0f, dist, mat);
+
+      screw_p = magnemite_point - Vec3N{body_radius / 3, 0.0f, -0.02f};
+      screw_p = {c1 * screw_p.x - s1 * screw_p.z, screw_p.y, s1 * screw_p.x + c1 * screw_p.z};
+      screw_p = {screw_p.x, c5 * screw_p.y + s5 * screw_p.z, -s5 * screw_p.y + c5 * screw_p.z};
+      screwb_top = screwBottom(screw_p, body_radius, screw_twist, 0.012f, screwb_half_y, 0.012f);
+      closer(near, screwb_top, 5.0f, dist, mat);
+    }
+
+    // rot * grass_point, rot = mat3(5/13, 0, 12/13, 0, 1, 0, -12/13, 0, 5/13).
+    FloatN fy = fract(point.y);
+    Vec3N grass_point = point;
+    grass_point.x = grass_point.x - -fy * fy * fy * (bend_factor * bend_factor);
+    grass_point = {5 / 13.0f * grass_point.x + -12 / 13.0f * grass_point.z,
+                   grass_point.y,
+                   12 / 13.0f * grass_point.x + 5 / 13.0f * grass_point.z};
+    Vec2N grass_xz = sdfOpRepeat2D(Vec2N{grass_point.x, grass_point.z}, 0.8f, 0.8f);
+    grass_point.x = grass_xz.x;
+    grass_point.z = grass_xz.y;
+    FloatN grass = drawGrass(grass_point);
+    closer(grass, 6.0f, dist, mat);
+
+    FloatN::Mask trees = point.z < -2.0f;
+    if (any(trees)) {
+      Vec3N tree_point = point;
+      tree_point.y = tree_point.y - -0.8f;
+      tree_point = tree_point * 0.5f;
+      Vec2N tree_xz = sdfOpRepeat2D(Vec2N{tree_point.x, tree_point.z}, 0.8f, 0.8f);
+      tree_point.x = tree_xz.x;
+      tree_point.z = tree_xz.y;
+      FloatN tree, tree_mat;
+      drawTree(tree_point, tree, tree_mat);
+      tree = tree / 0.5f;
+      FloatN::Mask take = trees & (tree < dist);
+      dist = select(take, tree, dist);
+      mat = select(take, tree_mat, mat);
+    }
+
+    FloatN::Mask clouds = point.y > 0.6f;
+    if (any(clouds)) {
+      Vec3N cloud_point = point;
+      cloud_point.x = cloud_point.x - -frame.time / 100;
+      cloud_point.y = cloud_point.y - 1.0f;
+      cloud_point.z = cloud_point.z - frame.time / 200;
+      Vec2N cloud_xz = sdfOpRepeat2D(Vec2N{cloud_point.x, cloud_point.z}, 3.0f, 3.0f);
+      cloud_point.x = cloud_xz.x;
+      cloud_point.z = cloud_xz.y;
+      FloatN cloud = drawCloud(cloud_point);
+      closer(clouds, cloud, 9.0f, dist, mat);
+    }
+
+    float plane_y_pos = -0.8f;
+    FloatN plane = point.y - plane_y_pos;
+    closer(plane, 10.0f, dist, mat);
+  }
+};
+//===== Section: Scenes =====//
+
+template<typename Scene>
+struct PacketMarcher {
+  const Scene &scene;
+  const CpuPacketFrame &frame;
+
+  void castRay(Vec3N ro, Vec3N rd, FloatN::Mask active, FloatN &t, FloatN &m, FloatN &steps) const {
+    t = 0.0f;
+    m = -1.0f;
+    steps = (float)frame.max_iterations;
+    for (int i = 0; i < frame.max_iterations && any(active); i++) {
+      FloatN dist, mat;
+      scene.scene(ro + t * rd, dist, mat);
+      m = select(active, mat, m);
+      FloatN::Mask hit = active & (dist < frame.eps);
+      active = active & ~hit;
+
+      t = select(active, t + dist, t);
+      FloatN::Mask escaped = active & (t > frame.far);
+      active = active & ~escaped;
+      steps = select(hit | escaped, FloatN((float)i), steps);
+    }
+    m = select(t > frame.far, FloatN(-1.0f), m);
+  }
+
+  // Tetrahedron Technique: https://iquilezles.org/articles/normalsSDF/
+  Vec3N sceneNormal(Vec3N point) const {
+    const float h = 0.0001f;
+    FloatN s[4], mat;
+    scene.scene(point + Vec3N{h, -h, -h}, s[0], mat);
+    scene.scene(point + Vec3N{-h, -h, h}, s[1], mat);
+    scene.scene(point + Vec3N{-h, h, -h}, s[2], mat);
+    scene.scene(point + Vec3N{h, h, h}, s[3], mat);
+    return normalize(Vec3N{s[0] - s[1] - s[2] + s[3],
+                           -s[0] - s[1] + s[2] + s[3],
+                           -s[0] + s[1] - s[2] + s[3]});
+  }
+
+  void march(const CpuRays &rays, int first, int lanes) const {
+    Vec3N ro{load(rays.origin[0], first, lanes), load(rays.origin[1], first, lanes), load(rays.origin[2], first, lanes)};
+    Vec3N rd{load(rays.dir[0], first, lanes), load(rays.dir[1], first, lanes), load(rays.dir[2], first, lanes)};
+
+    FloatN t, m, steps;
+    castRay(ro, rd, maskFirst(lanes), t, m, steps);
+    store(t, rays.t, first, lanes);
+    store(m, rays.material, first, lanes);
+    store(steps, rays.steps, first, lanes);
+
+    FloatN::Mask hit = maskFirst(lanes) & (m > 0.0f);
+    if (!any(hit)) return;
+
+    Vec3N point = ro + t * rd;
+    Vec3N normal = sceneNormal(point);
+    Vec3N sun_dir{frame.sun_dir[0], frame.sun_dir[1], frame.sun_dir[2]};
+    FloatN shadow_t, shadow_m, shadow_steps;
+    castRay(point + (normal * frame.eps), sun_dir, hit, shadow_t, shadow_m, shadow_steps);
+    store(normal.x, rays.normal[0], first, lanes);
+    store(normal.y, rays.normal[1], first, lanes);
+    store(normal.z, rays.normal[2], first, lanes);
+    store(select(0.0f < shadow_m, FloatN(0.0f), FloatN(1.0f)), rays.shadow, first, lanes);
+  }
+
+  // The last packet of a batch can be partial, its spare lanes repeat the
+  // first ray and are masked out.
+  static FloatN load(const float *values, int first, int lanes) {
+    if (lanes == FloatN::width) return FloatN::load(values + first);
+    float padded[FloatN::width];
+    for (int i = 0; i < FloatN::width; i++) padded[i] = values[first + (i < lanes ? i : 0)];
+    return FloatN::load(padded);
+  }
+
+  static void store(FloatN value, float *values, int first, int lanes) {
+    if (lanes == FloatN::width) return value.store(values + first);
+    float padded[FloatN::width];
+    value.store(padded);
+    for (int i = 0; i < lanes; i++) values[first + i] = padded[i];
+  }
+};
+
+template<typename Scene>
+void marchPackets(const CpuPacketFrame &frame, const CpuRays &rays) {
+  Scene scene{frame};
+  PacketMarcher<Scene> marcher{scene, frame};
+  for (int first = 0; first < rays.count; first += FloatN::width) {
+    int lanes = rays.count - first < FloatN::width ? rays.count - first : FloatN::width;
+    marcher.march(rays, first, lanes);
+  }
+}
+
+void marchRays(const CpuPacketFrame &frame, const CpuRays &rays) {
+  if (frame.scene_id == CPU_SCENE_MAGNEMITE) {
+    marchPackets<MagnemitePacket>(frame, rays);
+  } else {
+    marchPackets<GundamPacket>(frame, rays);
+  }
+}
+
+}  // namespace
+
+#endif
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "cpu_renderer.hpp"
+#include "magnemite_sdf.hpp"
+
+static const glm::vec3 UP(0.0f, 1.0f, 0.0f);
+static const glm::vec3 SUN_DIR = glm::normalize(glm::vec3(0.8f, 0.4f, 0.6f));
+static const float CAM_DEP = 1.5f;
+
+#define ANAGLYPH_OFF 0
+#define ANAGLYPH_NAIVE 1
+#define ANAGLYPH_DUBOIS 2
+
+#define EYE_CENTRE 0  // render2D's camera.
+#define EYE_LEFT 1
+#define EYE_RIGHT 2
+
+template<typename Scene>
+struct RayMarcher {
+  const Scene &scene;
+  const CpuFrame &frame;
+
+  // Tetrahedron Technique: https://iquilezles.org/articles/normalsSDF/
+  glm::vec3 sceneNormal(glm::vec3 point) const {
+    const float h = 0.0001f;
+    const glm::vec3 xyy(1.0f, -1.0f, -1.0f);
+    const glm::vec3 yyx(-1.0f, -1.0f, 1.0f);
+    const glm::vec3 yxy(-1.0f, 1.0f, -1.0f);
+    const glm::vec3 xxx(1.0f, 1.0f, 1.0f);
+    return glm::normalize(xyy * scene.scene(point + xyy * h).x +
+                          yyx * scene.scene(point + yyx * h).x +
+                          yxy * scene.scene(point + yxy * h).x +
+                          xxx * scene.scene(point + xxx * h).x);
+  }
+
+  glm::vec3 castRay(glm::vec3 ro, glm::vec3 rd) const {
+    float t = 0.0f;
+    float m = -1.0f;
+    int i;
+    for (i = 0; i < frame.max_iterations; i++) {
+      glm::vec3 p = ro + t * rd;
+      glm::vec2 res = scene.scene(p);
+      m = res.y;
+      if (res.x < frame.eps) break;
+
+      t += res.x;
+      if (t > frame.far) break;
+    }
+    if (t > frame.far) m = -1.0f;
+
+    return glm::vec3(t, m, (float)i);
+  }
+
+  void sceneLighting(glm::vec3 point, glm::vec3 ray_info, glm::vec3 &colour) const {
+    glm::vec3 normal = sceneNormal(point);
+    float sun_sha = glm::step(castRay(point + (normal * frame.eps), SUN_DIR).y, 0.0f);
+    colour = light(scene.sceneColor(ray_info.y, point), normal, sun_sha);
+  }
+
+  static glm::vec3 light(glm::vec3 base_material, glm::vec3 normal, float sun_sha) {
+    float sun_dif     = glm::clamp(glm::dot(normal, SUN_DIR), 0.0f, 1.0f);
+    float sky_dif     = glm::clamp(0.5f + 0.5f * glm::dot(normal, UP), 0.0f, 1.0f);
+    float bounce_diff = glm::clamp(0.5f + 0.5f * glm::dot(normal, -UP), 0.0f, 1.0f);
+
+    glm::vec3 colour = base_material * glm::vec3(7.0f, 4.5f, 3.0f) * sun_dif * sun_sha;
+    colour += base_material * glm::vec3(0.5f, 0.8f, 0.9f) * sky_dif;
+    colour += base_material * glm::vec3(0.7f, 0.3f, 0.2f) * bounce_diff;
+    return colour;
+  }
+
+  static glm::vec3 rayDir(glm::vec3 ray_origin, glm::vec3 cam_target, glm::vec2 coord) {
+    glm::vec3 forward = glm::normalize(cam_target - ray_origin);
+    glm::vec3 right   = glm::normalize(glm::cross(forward, UP));
+    glm::vec3 up      = glm::normalize(glm::cross(right, forward));
+    return glm::normalize(coord.x * right + coord.y * up + CAM_DEP * forward);
+  }
+
+  glm::vec3 sky(glm::vec2 coord, glm::vec3 rd) const {
+    glm::vec3 colour = glm::vec3(0.4f, 0.75f, 1.0f) - 0.6f * coord.y;
+    return glm::mix(colour, glm::vec3(0.7f, 0.75f, 0.8f), glm::exp(-10.0f * rd.y));
+  }
+
+  glm::vec2 coord(glm::vec2 frag_coord) const {
+    glm::vec2 resolution(frame.resolution.x, frame.resolution.y);
+    return ((2.0f * frag_coord) - resolution) / frame.resolution.y;
+  }
+
+  glm::vec3 origin(int eye) const {
+    if (eye == EYE_LEFT) return glm::vec3(0.0f - 0.01f, 0.0f, 1.0f);
+    if (eye == EYE_RIGHT) return glm::vec3(0.0f + 0.01f, 0.0f, 1.0f);
+
+    float cam_angle = frame.mouse.z == 1 ? -(10.0f * frame.mouse.x) / frame.resolution.x : 0.0f;
+    return glm::vec3(1.0f * glm::sin(cam_angle), 0.0f, 1.0f * glm::cos(cam_angle));
+  }
+
+  void render2D(glm::vec2 frag_coord, glm::vec3 &colour, glm::vec3 &ray_info) const {
+    glm::vec2 uv = coord(frag_coord);
+    glm::vec3 ro = origin(EYE_CENTRE);
+    glm::vec3 cam_target(0.0f, 0.0f, 0.0f);
+    glm::vec3 rd = rayDir(ro, cam_target, uv);
+
+    colour = sky(uv, rd);
+    ray_info = castRay(ro, rd);
+    if (ray_info.y > 0.0f) {
+      glm::vec3 point = ro + ray_info.x * rd;
+      sceneLighting(point, ray_info, colour);
+    }
+  }
+
+  void render3D(glm::vec2 frag_coord, glm::vec3 &left_colour, glm::vec3 &right_colour, glm::vec3 &ray_info) const {
+    glm::vec2 uv = coord(frag_coord);
+    glm::vec3 cam_target(0.0f, 0.0f, 0.0f);
+
+    // Left Eye.
+    glm::vec3 ro = origin(EYE_LEFT);
+    glm::vec3 rd = rayDir(ro, cam_target, uv);
+    left_colour = sky(uv, rd);
+    ray_info = castRay(ro, rd);
+    if (ray_info.y > 0.0f) sceneLighting(ro + ray_info.x * rd, ray_info, left_colour);
+
+    // Right Eye.
+    ro = origin(EYE_RIGHT);
+    rd = rayDir(ro, cam_target, uv);
+    right_colour = sky(uv, rd);
+    ray_info = castRay(ro, rd);
+    if (ray_info.y > 0.0f) sceneLighting(ro + ray_info.x * rd, ray_info, right_colour);
+  }
+
+  // main() of ray_marcher.glsl.
+  void shade(glm::vec2 frag_coord, glm::vec3 &colour, glm::vec3 &ray_info) const {
+    if (frame.anaglyph == ANAGLYPH_OFF) {
+      render2D(frag_coord, colour, ray_info);
+      colour = finish(colour, colour);
+    } else {
+      glm::vec3 left_colour;
+      glm::vec3 right_colour;
+      render3D(frag_coord, left_colour, right_colour, ray_info);
+      colour = finish(left_colour, right_colour);
+    }
+  }
+
+  // The end of main(): combine the eyes and gamma correct.
+  glm::vec3 finish(glm::vec3 left_colour, glm::vec3 right_colour) const {
+    glm::vec3 colour = left_colour;
+    if (frame.anaglyph == ANAGLYPH_NAIVE) {
+      colour = left_colour * glm::vec3(1.0f, 0.0f, 0.0f) + right_colour * glm::vec3(0.0f, 1.0f, 1.0f);
+    } else if (frame.anaglyph == ANAGLYPH_DUBOIS) {
+      glm::mat3 lf(
+         0.4561f,     0.500484f,   0.176381f,
+        -0.400822f,  -0.0378246f, -0.0157589f,
+        -0.0152161f, -0.0205971f, -0.00546856f
+      );
+      glm::mat3 rf(
+        -0.0434706f, -0.0879388f, -0.00155529f,
+         0.378476f,   0.73364f,   -0.0184503f,
+        -0.0721527f, -0.112961f,   1.2264f
+      );
+      colour = glm::clamp(left_colour * lf, glm::vec3(0.0f), glm::vec3(1.0f)) +
+               glm::clamp(right_colour * rf, glm::vec3(0.0f), glm::vec3(1.0f));
+    }
+    return glm::pow(colour, glm::vec3(0.4545f));
+  }
+};
+
+// GL's float to unorm conversion. pow() of the negative sky above the
+// horizon is NaN, which GPUs store as 0.
+static uint8_t unorm8(float value) {
+  return value > 0.0f ? (uint8_t)(std::min(value, 1.0f) * 255.0f + 0.5f) : 0;
+}
+
+// Rays of one tile for a packet kernel, and the colour of each eye.
+struct TileRays {
+  float origin[3][CPU_TILE_SIZE * CPU_TILE_SIZE];
+  float dir[3][CPU_TILE_SIZE * CPU_TILE_SIZE];
+  float t[CPU_TILE_SIZE * CPU_TILE_SIZE];
+  float material[CPU_TILE_SIZE * CPU_TILE_SIZE];
+  float steps[CPU_TILE_SIZE * CPU_TILE_SIZE];
+  float normal[3][CPU_TILE_SIZE * CPU_TILE_SIZE];
+  float shadow[CPU_TILE_SIZE * CPU_TILE_SIZE];
+  glm::vec3 colour[2][CPU_TILE_SIZE * CPU_TILE_SIZE];
+};
+
+// One per pool thread, kept between frames.
+static thread_local std::unique_ptr<TileRays> tile_rays;
+
+using MarchRays = void (*)(const CpuPacketFrame &frame, const CpuRays &rays);
+
+static void packetScene(const GundamScene &scene, CpuPacketFrame &packet_frame) {
+  for (int i = 0; i < CPU_GUNDAM_DETAIL; i++) {
+    for (int j = 0; j < 9; j++) packet_frame.gundam_rot[i][j] = scene.detail_rot[i][j / 3][j % 3];
+    packet_frame.gundam_offset[i][0] = scene.detail_offset[i].x;
+    packet_frame.gundam_offset[i][1] = scene.detail_offset[i].y;
+  }
+}
+
+static void packetScene(const MagnemiteScene &scene, CpuPacketFrame &packet_frame) {
+  for (int j = 0; j < 16; j++) packet_frame.magnemite_tx[j] = scene.magnemite_tx[j / 4][j % 4];
+}
+
+static void packetScene(const MagnemiteSdfScene &, CpuPacketFrame &) {}
+
+// A tile through a packet kernel: each eye's rays are marched as one batch,
+// then lit like sceneLighting with the normals and shadows it found.
+template<typename Scene>
+static void shadeTilePackets(const RayMarcher<Scene> &marcher, const CpuPacketFrame &packet_frame, MarchRays march,
+                             TileRays &tile, int x0, int y0, CpuImage &image) {
+  const CpuFrame &frame = marcher.frame;
+  int x1 = std::min(x0 + CPU_TILE_SIZE, image.width);
+  int y1 = std::min(y0 + CPU_TILE_SIZE, image.height);
+  int eyes = frame.anaglyph == ANAGLYPH_OFF ? 1 : 2;
+  glm::vec3 cam_target(0.0f, 0.0f, 0.0f);
+
+  for (int e = 0; e < eyes; e++) {
+    glm::vec3 ro = marcher.origin(eyes == 1 ? EYE_CENTRE : EYE_LEFT + e);
+    int count = 0;
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++, count++) {
+        glm::vec3 rd = marcher.rayDir(ro, cam_target, marcher.coord(glm::vec2(x + 0.5f, y + 0.5f)));
+        for (int c = 0; c < 3; c++) {
+          tile.origin[c][count] = ro[c];
+          tile.dir[c][count] = rd[c];
+        }
+      }
+    }
+
+    march(packet_frame, CpuRays{
+      .count = count,
+      .origin = {tile.origin[0], tile.origin[1], tile.origin[2]},
+      .dir = {tile.dir[0], tile.dir[1], tile.dir[2]},
+      .t = tile.t,
+      .material = tile.material,
+      .steps = tile.steps,
+      .normal = {tile.normal[0], tile.normal[1], tile.normal[2]},
+      .shadow = tile.shadow,
+    });
+
+    count = 0;
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++, count++) {
+        glm::vec3 rd(tile.dir[0][count], tile.dir[1][count], tile.dir[2][count]);
+        glm::vec3 &colour = tile.colour[e][count];
+        colour = marcher.sky(marcher.coord(glm::vec2(x + 0.5f, y + 0.5f)), rd);
+        if (tile.material[count] > 0.0f) {
+          glm::vec3 point = ro + tile.t[count] * rd;
+          glm::vec3 normal(tile.normal[0][count], tile.normal[1][count], tile.normal[2][count]);
+          colour = marcher.light(marcher.scene.sceneColor(tile.material[count], point), normal, tile.shadow[count]);
+        }
+      }
+    }
+  }
+
+  int count = 0;
+  for (int y = y0; y < y1; y++) {
+    for (int x = x0; x < x1; x++, count++) {
+      glm::vec3 colour = marcher.finish(tile.colour[0][count], tile.colour[eyes - 1][count]);
+      size_t pixel = (size_t)y * image.width + x;
+      image.colour[pixel * 4 + 0] = unorm8(colour.x);
+      image.colour[pixel * 4 + 1] = unorm8(colour.y);
+      image.colour[pixel * 4 + 2] = unorm8(colour.z);
+      image.colour[pixel * 4 + 3] = 255;
+      image.iterations[pixel] = (uint16_t)tile.steps[count];  // Last eye, like ray_info.
+    }
+  }
+}
+
+template<typename Scene>
+static void shadeTile(const RayMarcher<Scene> &marcher, int x0, int y0, CpuImage &image) {
+  for (int y = y0; y < std::min(y0 + CPU_TILE_SIZE, image.height); y++) {
+    for (int x = x0; x < std::min(x0 + CPU_TILE_SIZE, image.width); x++) {
+      glm::vec3 colour;
+      glm::vec3 ray_info;
+      marcher.shade(glm::vec2(x + 0.5f, y + 0.5f), colour, ray_info);  // Pixel centres, like gl_FragCoord.
+
+      size_t pixel = (size_t)y * image.width + x;
+      image.colour[pixel * 4 + 0] = unorm8(colour.x);
+      image.colour[pixel * 4 + 1] = unorm8(colour.y);
+      image.colour[pixel * 4 + 2] = unorm8(colour.z);
+      image.colour[pixel * 4 + 3] = 255;
+      image.iterations[pixel] = (uint16_t)ray_info.z;
+    }
+  }
+}
+
+template<typename Scene>
+static void renderTiles(const CpuRenderOpts &opts, const CpuFrame &frame, MarchRays march, TaskPool &pool, CpuImage &image) {
+  Scene scene{frame};
+  RayMarcher<Scene> marcher{scene, frame};
+
+  CpuPacketFrame packet_frame{
+    .scene_id = opts.scene_id,
+    .max_iterations = frame.max_iterations,
+    .eps = frame.eps,
+    .far = frame.far,
+    .time = frame.time,
+    .sun_dir = {SUN_DIR.x, SUN_DIR.y, SUN_DIR.z},
+    .magnemite_tx = {},
+    .gundam_rot = {},
+    .gundam_offset = {},
+  };
+  packetScene(scene, packet_frame);
+
+  pool.parallelFor2D(image.width, image.height, CPU_TILE_SIZE, CPU_TILE_SIZE, [&](int x0, int y0, int, int) {
+    auto start = std::chrono::steady_clock::now();
+    if (march) {
+      if (!tile_rays) tile_rays = std::make_unique<TileRays>();
+      shadeTilePackets(marcher, packet_frame, march, *tile_rays, x0, y0, image);
+    } else {
+      shadeTile(marcher, x0, y0, image);
+    }
+    image.tile_ms[(y0 / CPU_TILE_SIZE) * image.tiles_x + x0 / CPU_TILE_SIZE] =
+      std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  });
+}
+
+int cpuBestKernel() {
+#if defined(CSCI_4110U_CPU_PACKETS) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 27))) return CPU_KERNEL_SCALAR;  // No XGETBV, the OS does not save AVX state.
+  unsigned long long xcr0 = _xgetbv(0);
+  __cpuidex(info, 7, 0);
+  if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6) return CPU_KERNEL_AVX512;
+  if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) return CPU_KERNEL_AVX2;
+#elif defined(CSCI_4110U_CPU_PACKETS)
+  // Also checks that the OS saves the registers.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return CPU_KERNEL_AVX512;
+  if (__builtin_cpu_supports("avx2")) return CPU_KERNEL_AVX2;
+#endif
+  return CPU_KERNEL_SCALAR;
+}
+
+CpuImage renderCpu(const CpuRenderOpts &opts, TaskPool &pool) {
+  CpuImage image{.width = opts.width, .height = opts.height};
+  image.colour.resize((size_t)opts.width * opts.height * 4);
+  image.iterations.resize((size_t)opts.width * opts.height);
+  image.tiles_x = (opts.width + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+  image.tiles_y = (opts.height + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+  image.tile_ms.resize((size_t)image.tiles_x * image.tiles_y);
+
+  CpuFrame frame = opts.frame;
+  frame.resolution = glm::vec3(opts.width, opts.height, 0.0f);
+
+  MarchRays march = nullptr;
+#if defined(CSCI_4110U_CPU_PACKETS)
+  switch (opts.kernel == CPU_KERNEL_AUTO ? cpuBestKernel() : opts.kernel) {
+    case CPU_KERNEL_AVX512:
+      march = marchRaysAvx512;
+      image.kernel = CPU_KERNEL_AVX512;
+      break;
+    case CPU_KERNEL_AVX2:
+      march = marchRaysAvx2;
+      image.kernel = CPU_KERNEL_AVX2;
+      break;
+  }
+#endif
+
+  switch (opts.scene_id) {
+    case CPU_SCENE_MAGNEMITE:
+      renderTiles<MagnemiteScene>(opts, frame, march, pool, image);
+      break;
+    case CPU_SCENE_MAGNEMITE_SDF:
+      // The packet kernels only know the hand written scenes.
+      image.kernel = CPU_KERNEL_SCALAR;
+      renderTiles<MagnemiteSdfScene>(opts, frame, nullptr, pool, image);
+      break;
+    default:
+      renderTiles<GundamScene>(opts, frame, march, pool, image);
+  }
+  return image;
+}
@@ -0,0 +1,47 @@
+#ifndef CSCI_4110U_CPU_RENDERER_H
+#define CSCI_4110U_CPU_RENDERER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu_packet.hpp"
+#include "cpu_scenes.hpp"
+#include "task_pool.hpp"
+
+#define CPU_TILE_SIZE 16  // Pixels, square, the unit of work of the task pool.
+
+struct CpuRenderOpts {
+  int width = 1152;
+  int height = 720;
+  int scene_id = CPU_SCENE_GUNDAM;
+  CpuFrame frame{};  // `resolution` is filled in from width and height.
+  int kernel = CPU_KERNEL_AUTO;  // CPU_KERNEL_*, AUTO for cpuBestKernel().
+};
+
+// What the scene pass writes to its two attachments, rows bottom to top like
+// glReadPixels.
+struct CpuImage {
+  int width = 0;
+  int height = 0;
+  int kernel = CPU_KERNEL_SCALAR;      // CPU_KERNEL_* the rays were marched with.
+  std::vector<uint8_t> colour{};       // RGBA8.
+  std::vector<uint16_t> iterations{};  // Ray march steps, R16UI.
+  int tiles_x = 0;
+  int tiles_y = 0;
+  std::vector<float> tile_ms{};  // Time spent on each tile, same row order.
+};
+
+/* shaders/util/ray_marcher.glsl on the CPU: castRay, sceneNormal,
+   sceneLighting, render2D/render3D and main for every pixel, the frame split
+   into CPU_TILE_SIZE tiles run by the pool. Float maths differs from
+   the GPU's in the last bits, a few edge pixels can differ by a step.
+
+   The AVX2 and AVX-512 kernels march a tile's rays in packets and leave
+   the shading to the scalar code. The kernel must be supported by the CPU.
+*/
+CpuImage renderCpu(const CpuRenderOpts &opts, TaskPool &pool);
+
+// Widest kernel this build and CPU can run.
+int cpuBestKernel();
+
+#endif
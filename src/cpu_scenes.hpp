@@ -0,0 +1,365 @@
+#ifndef CSCI_4110U_CPU_SCENES_H
+#define CSCI_4110U_CPU_SCENES_H
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "cpu_sdf.hpp"
+
+#define CPU_SCENE_GUNDAM 0     // Same order as scene_names in main.cpp.
+#define CPU_SCENE_MAGNEMITE 1
+#define CPU_SCENE_MAGNEMITE_SDF 2  // MagnemiteSdfScene
+
+#define CPU_GUNDAM_DETAIL 4  // Layers of spheres on the ground, `iterations` of detail().
+
+// Constants of shaders/util/common.glsl.
+inline constexpr float CPU_PI = 3.1415f;
+inline constexpr float CPU_UNKNOWN_MAT = 0.0f;
+
+// The `Frame` uniform block and the quality preset's ray march limits.
+struct CpuFrame {
+  glm::vec3 mouse{0.0f};
+  float time = 0.0f;
+  glm::vec3 resolution{0.0f};
+  int anaglyph = 0;
+  int max_iterations = 128;  // MAX_ITERATIONS
+  float eps = 0.001f;        // EPS
+  float far = 20.0f;         // FAR
+};
+
+/* The scenes of shaders/gundam.glsl and shaders/magnemite.glsl, kept in the
+   same order and with the same names so a change to one is easy to carry
+   over to the other. Everything that only depends on the frame is worked
+   out in the constructor. Defined here so the renderer can inline them.
+*/
+
+struct GundamScene {
+  float far;
+  glm::mat3 detail_rot[CPU_GUNDAM_DETAIL];     // Rotation of each layer of spheres.
+  glm::vec2 detail_offset[CPU_GUNDAM_DETAIL];  // xz offset of each layer, from pcg3d.
+
+  GundamScene(const CpuFrame &frame) : far(frame.far) {
+    glm::mat3 rot(57 / 185.0f, 0.0f, -176 / 185.0f,
+                  0.0f, 1.0f, 0.0f,
+                  176 / 185.0f, 0.0f, 57 / 185.0f);
+    for (int i = 0; i < CPU_GUNDAM_DETAIL; i++) {
+      detail_rot[i] = rot;
+      rot = rot * rot;
+
+      glm::vec3 offset = 4.0f * pcg3d(glm::vec3((float)i));
+      detail_offset[i] = glm::vec2(offset.x, offset.z);
+    }
+  }
+
+  float detail(float base, glm::vec3 point) const {
+    float d = base;
+    for (int i = 0; i < CPU_GUNDAM_DETAIL; i++) {
+      point = point * detail_rot[i];
+
+      glm::vec3 p = point;
+      p.x += detail_offset[i].x;
+      p.z += detail_offset[i].y;
+      p.y += 0.4f;
+      glm::vec2 xz = sdfOpRepeat2D(glm::vec2(p.x, p.z), glm::vec2(2, 2));
+      p.x = xz.x;
+      p.z = xz.y;
+      float s = sdfSphere(p, 0.4f);
+      d = sdfOpSmoothMin(d, s, 0.1f);
+    }
+    return d;
+  }
+
+  glm::vec2 scene(glm::vec3 point) const {
+    glm::vec2 res(far, CPU_UNKNOWN_MAT);
+
+    float plane_y_pos = -0.8f;
+    float plane = point.y - plane_y_pos;
+    res = glm::vec2(plane, 1.0f);
+
+    glm::vec3 detail_point = point + glm::vec3(0, 0.9f, 0);
+    res.x = detail(res.x, detail_point);
+
+    float box = sdfBox(point, glm::vec3(0.5f, 0.2f, 0.2f));
+    if (box < res.x) res.x = box;
+
+    return res;
+  }
+
+  glm::vec3 sceneColor(float id, glm::vec3) const {
+    if (id < 0.5f) return glm::vec3(1.0f, 0.0f, 0.0f);
+    if (id < 1.5f) return glm::vec3(0.3f, 0.25f, 0.2f);
+    if (id < 2.5f) return glm::vec3(0.0f, 1.0f, 1.0f);
+    return glm::vec3(0.0f);  // Uninitialised in the shader, never hit.
+  }
+};
+
+struct MagnemiteScene {
+  float time;
+  float far;
+  glm::mat4 magnemite_tx{1.0f};
+
+  MagnemiteScene(const CpuFrame &frame) : time(frame.time), far(frame.far) {
+    const float ANIMATION_DURATION = 2;
+
+    float ty = glm::sin(time * 2) * 0.1f;
+    float ss = glm::sin(time * CPU_PI / ANIMATION_DURATION);
+    float square_wave = glm::max(glm::sign(ss), 0.0f);
+    float tz = -0.5f * ss * square_wave;
+
+    glm::mat4 magnemite_rot(1.0f);
+    if ((int)glm::floor(time / ANIMATION_DURATION) % 2 != 0) {
+      float s = glm::sin(time * 2 * CPU_PI);
+      float c = glm::cos(time * 2 * CPU_PI);
+      magnemite_rot = glm::mat4(
+         c, s, 0, 0,
+        -s, c, 0, 0,
+         0, 0, 1, 0,
+         0, 0, 0, 1
+      );
+    }
+    glm::mat4 magnemite_trans(1.0f);
+    magnemite_trans[1].w = ty;
+    magnemite_trans[2].w = tz;
+
+    magnemite_tx = magnemite_trans * magnemite_rot;
+  }
+
+  static float drawGrass(glm::vec3 point) {
+    point.y -= -0.8f;
+
+    glm::vec3 point_r = point;
+    glm::vec2 xz = sdfOpRepeat2DClamped(glm::vec2(point_r.x, point_r.z), glm::vec2(0.1f, 0.1f), glm::vec2(1, 1));
+    point_r.x = xz.x;
+    point_r.z = xz.y;
+    float grass_grouped = sdfVesica2D(glm::vec2(point_r.x, point_r.y), 0.5f, 0.707f) - 0.25f;
+    grass_grouped = sdfOpExtrude(point_r, grass_grouped, 0.02f);
+
+    glm::vec3 point_h = point;
+    point_h.x = glm::abs(point_h.x);
+    point_h.x -= 0.19f;
+    float grass_h = sdfVesica2D(glm::vec2(point_h.x, point_h.y), 0.5f, 0.707f) - 0.25f;
+    grass_h = sdfOpExtrude(point_h, grass_h, 0.02f);
+
+    glm::vec3 point_v = point;
+    point_v.z = glm::abs(point_v.z);
+    point_v.z -= 0.19f;
+    float grass_v = sdfVesica2D(glm::vec2(point_v.x, point_v.y), 0.5f, 0.707f) - 0.25f;
+    grass_v = sdfOpExtrude(point_v, grass_v, 0.02f);
+
+    return glm::min(grass_grouped, glm::min(grass_h, grass_v));
+  }
+
+  static glm::vec2 drawTree(glm::vec3 point) {
+    float trunk_height = 0.2f;
+    float trunk_radius = 0.05f;
+    float leaf_height = 0.25f;
+    float leaf_angle = CPU_PI / 3.2f;
+
+    float trunk = sdfVerticalCapsule(point, trunk_height, trunk_radius);
+
+    glm::vec2 sc(glm::sin(leaf_angle), glm::cos(leaf_angle));
+    point.y -= trunk_height + leaf_height;
+    float cone1 = sdfCone(point, sc, leaf_height);
+    leaf_height -= 0.05f;
+    point.y -= leaf_height / 3;
+    float cone2 = sdfCone(point, sc, leaf_height);
+    leaf_height -= 0.05f;
+    point.y -= leaf_height / 3;
+    float cone3 = sdfCone(point, sc, leaf_height);
+    float leaves = glm::min(cone1, glm::min(cone2, cone3));
+
+    return trunk < leaves ? glm::vec2(trunk, 7.0f) : glm::vec2(leaves, 8.0f);
+  }
+
+  static float drawCloud(glm::vec3 point) {
+    glm::vec3 box_half_size(0.2f, 0.03f, 0.1f);
+    return sdfBox(point, box_half_size) - 0.02f;
+  }
+
+  // The bottom screws only differ in their offset and the direction of the
+  // first rotation.
+  static float screwBottom(glm::vec3 screw_p, float body_radius, float screw_twist, glm::vec3 screwb_half_size) {
+    glm::vec3 screwb_point = sdfOpTwistY(screw_p, screw_twist);
+    screwb_point -= glm::vec3(0.0f, body_radius + screwb_half_size.y - 0.01f, 0.0f);
+    float screwb_body = sdfBox(screwb_point, screwb_half_size) - 0.002f;
+
+    glm::vec3 screwb_head_point = screw_p;
+    screwb_head_point.y -= body_radius + screwb_half_size.y - 0.055f;
+    float screwb_head = sdfCutSphere(screwb_head_point, 0.09f, 0.08f) - 0.003f;
+
+    screwb_head_point = screw_p;
+    screwb_head_point.y -= 0.215f;
+    float screwb_hole1 = sdfBox(screwb_head_point, glm::vec3(0.030f, 0.013f, 0.010f));
+    float screwb_hole2 = sdfBox(screwb_head_point, glm::vec3(0.010f, 0.013f, 0.030f));
+    float screwb_hole = glm::min(screwb_hole1, screwb_hole2);
+
+    return glm::max(-screwb_hole, glm::min(screwb_body, screwb_head));
+  }
+
+  glm::vec2 scene(glm::vec3 point) const {
+    glm::vec2 res(far, CPU_UNKNOWN_MAT);
+
+    glm::vec3 magnemite_point = glm::vec3(glm::vec4(point, 1.0f) * magnemite_tx);
+
+    float body_radius = 0.15f;
+    float body = sdfSphere(magnemite_point, body_radius);
+    res = glm::vec2(body, 1.0f);
+
+    // Use body as bounding volume
+    if (body - 1 < 0) {
+      float arm_curve = CPU_PI / 2;
+      float arm_radius = 0.05f;
+      float arm_thickness = 0.02f;
+      float arm_length = 0.10f;
+      glm::vec2 arm_len_thick(arm_length, arm_thickness);
+      glm::vec3 arm_offset(body_radius + arm_radius + arm_thickness, 0.0f, 0.0f);
+
+      glm::vec3 arm_point = magnemite_point;
+      arm_point.x = glm::abs(arm_point.x);
+      arm_point -= arm_offset;
+      arm_point = glm::vec3(-arm_point.y, arm_point.x, arm_point.z);
+
+      float arms2D = sdfHorseshoe2D(glm::vec2(arm_point.x, arm_point.y), glm::vec2(glm::cos(arm_curve), glm::sin(arm_curve)),
+                                    arm_radius, arm_len_thick);
+      float arms = sdfOpExtrude(magnemite_point, arms2D, arm_thickness);
+      if (arms < res.x) res = glm::vec2(arms, 2.0f);
+
+      glm::vec3 tips_point = magnemite_point;
+      glm::vec3 tips_half_size(arm_thickness);
+      glm::vec3 tips_offset(
+        body_radius + arm_radius + arm_length + (2 * arm_thickness),
+        arm_radius + ((arm_thickness - tips_half_size.y) / 2),
+        0.0f
+      );
+      tips_point.x = glm::abs(tips_point.x);
+      if (magnemite_point.x > 0) tips_point.y = -tips_point.y;
+
+      float tips_red = sdfBox(tips_point - tips_offset, tips_half_size);
+      if (tips_red < res.x) res = glm::vec2(tips_red, 3.0f);
+
+      tips_offset.y = -tips_offset.y;
+      float tips_blue = sdfBox(tips_point - tips_offset, tips_half_size);
+      if (tips_blue < res.x) res = glm::vec2(tips_blue, 4.0f);
+
+      glm::vec3 screw_half_size(0.02f, body_radius * 0.3f, 0.02f);
+      float screw_twist = 100;
+
+      glm::vec3 screw_point = magnemite_point;
+      screw_point = sdfOpTwistY(screw_point, screw_twist);
+      screw_point -= glm::vec3(0.0f, body_radius + screw_half_size.y - 0.01f, 0.0f);
+      float screw_body = sdfBox(screw_point, screw_half_size) - 0.002f;
+
+      glm::vec3 screw_head_point = magnemite_point;
+      screw_head_point.y -= body_radius + screw_half_size.y - 0.035f;
+      float screw_head = sdfCutSphere(screw_head_point, 0.1f, 0.08f) - 0.003f;
+
+      screw_head_point = magnemite_point;
+      screw_head_point.y -= 0.25f;
+      float screw_hole1 = sdfBox(screw_head_point, glm::vec3(0.040f, 0.013f, 0.013f));
+      float screw_hole2 = sdfBox(screw_head_point, glm::vec3(0.013f, 0.013f, 0.040f));
+      float screw_hole = glm::min(screw_hole1, screw_hole2);
+
+      float screw_top = glm::max(-screw_hole, glm::min(screw_body, screw_head));
+      if (screw_top < res.x) res = glm::vec2(screw_top, 5.0f);
+
+      glm::vec3 screwb_half_size(0.012f, body_radius * 0.2f, 0.012f);
+      float c1 = glm::cos(CPU_PI * 1 / 8);
+      float s1 = glm::sin(CPU_PI * 1 / 8);
+      float c5 = glm::cos(CPU_PI * 5 / 8);
+      float s5 = glm::sin(CPU_PI * 5 / 8);
+      glm::mat3 tilt(
+        1,   0,  0,
+        0,  c5, s5,
+        0, -s5, c5);
+
+      glm::vec3 screw_p = magnemite_point - glm::vec3(-body_radius / 3, 0, -0.02f);
+      screw_p = screw_p * glm::mat3(
+         c1, 0, s1,
+          0, 1,  0,
+        -s1, 0, c1);
+      screw_p = screw_p * tilt;
+      float screwb_top = screwBottom(screw_p, body_radius, screw_twist, screwb_half_size);
+      if (screwb_top < res.x) res = glm::vec2(screwb_top, 5.0f);
+
+      screw_p = magnemite_point - glm::vec3(body_radius / 3, 0, -0.02f);
+      screw_p = screw_p * glm::mat3(
+        c1, 0, -s1,
+         0, 1,   0,
+        s1, 0,  c1);
+      screw_p = screw_p * tilt;
+      screwb_top = screwBottom(screw_p, body_radius, screw_twist, screwb_half_size);
+      if (screwb_top < res.x) res = glm::vec2(screwb_top, 5.0f);
+    }
+
+    float bend_factor = glm::sin(time / 2);
+    float fy = glm::fract(point.y);
+    glm::mat3 rot(
+       5 / 13.0f,  0.0f, 12 / 13.0f,
+       0.0f,       1.0f, 0.0f,
+      -12 / 13.0f, 0.0f, 5 / 13.0f
+    );
+
+    glm::vec3 grass_point = point;
+    grass_point.x -= -fy * fy * fy * (bend_factor * bend_factor);
+    grass_point = rot * grass_point;
+    glm::vec2 grass_xz = sdfOpRepeat2D(glm::vec2(grass_point.x, grass_point.z), glm::vec2(0.8f, 0.8f));
+    grass_point.x = grass_xz.x;
+    grass_point.z = grass_xz.y;
+    float grass = drawGrass(grass_point);
+    if (grass < res.x) res = glm::vec2(grass, 6.0f);
+
+    if (point.z < -2) {
+      glm::vec3 tree_point = point;
+      tree_point.y -= -0.8f;
+      tree_point *= 0.5f;
+      glm::vec2 tree_xz = sdfOpRepeat2D(glm::vec2(tree_point.x, tree_point.z), glm::vec2(0.8f));
+      tree_point.x = tree_xz.x;
+      tree_point.z = tree_xz.y;
+      glm::vec2 tree = drawTree(tree_point);
+      tree.x /= 0.5f;
+      if (tree.x < res.x) res = tree;
+    }
+
+    if (point.y > 0.6f) {
+      glm::vec3 cloud_point = point;
+      cloud_point.x -= -time / 100;
+      cloud_point.y -= 1;
+      cloud_point.z -= time / 200;
+      glm::vec2 cloud_xz = sdfOpRepeat2D(glm::vec2(cloud_point.x, cloud_point.z), glm::vec2(3.0f));
+      cloud_point.x = cloud_xz.x;
+      cloud_point.z = cloud_xz.y;
+      float cloud = drawCloud(cloud_point);
+      if (cloud < res.x) res = glm::vec2(cloud, 9.0f);
+    }
+
+    float plane_y_pos = -0.8f;
+    float plane = point.y - plane_y_pos;
+    if (plane < res.x) res = glm::vec2(plane, 10.0f);
+
+    return res;
+  }
+
+  glm::vec3 sceneColor(float id, glm::vec3 point) const {
+    if (id < 0.5f) return glm::vec3(1.0f, 0.0f, 1.0f);
+    if (id < 1.5f) {  // Body
+      glm::vec3 n = glm::normalize(glm::vec3(glm::vec4(point, 1.0f) * magnemite_tx));
+      float d = glm::dot(n, glm::vec3(0, 0, 1.0f));
+      if (d > 0.995f) return glm::vec3(0.005f);  // Black pupil
+      if (d > 0.9f) return glm::vec3(0.2f);      // White sclera
+      if (d > 0.89f) return glm::vec3(0.005f);   // Black outline
+      return glm::vec3(0.05f, 0.10f, 0.20f);
+    }
+    if (id < 2.5f) return glm::vec3(0.05f, 0.07f, 0.10f);  // Arms
+    if (id < 3.5f) return glm::vec3(0.15f, 0.02f, 0.02f);  // Red tips
+    if (id < 4.5f) return glm::vec3(0.02f, 0.02f, 0.15f);  // Blue tips
+    if (id < 5.5f) return glm::vec3(0.08f, 0.10f, 0.12f);  // Screws
+    if (id < 6.5f) return glm::vec3(0.04f, 0.20f, 0.02f);  // Grass
+    if (id < 7.5f) return glm::vec3(0.04f, 0.03f, 0.00f);  // Tree
+    if (id < 8.5f) return glm::vec3(0.01f, 0.05f, 0.01f);  // Tree leaves
+    if (id < 9.5f) return glm::vec3(0.30f, 0.30f, 0.30f);  // Cloud
+    return glm::vec3(0.05f, 0.07f, 0.10f);
+  }
+};
+
+#endif
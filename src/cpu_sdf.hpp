@@ -0,0 +1,118 @@
+#ifndef CSCI_4110U_CPU_SDF_H
+#define CSCI_4110U_CPU_SDF_H
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+/* shaders/util/sdf.glsl on the CPU, line for line so that the two can be
+   compared. Swizzles are spelled out, glm only has them with
+   GLM_FORCE_SWIZZLE.
+*/
+
+inline float sdfOpExtrude(glm::vec3 point, float d, float amount) {
+  glm::vec2 w(d, glm::abs(point.z) - amount);
+  return glm::min(glm::max(w.x, w.y), 0.0f) + glm::length(glm::max(w, 0.0f));
+}
+
+inline glm::vec2 sdfOpRepeatMirroredClamped(glm::vec2 point, float scale, glm::vec2 repititions) {
+  glm::vec2 id = glm::round(point / scale);
+  id.x = glm::clamp(id.x, -(repititions.x - 1.0f), repititions.x - 1.0f);
+  id.y = glm::clamp(id.y, -(repititions.y - 0.0f), repititions.y - 1.0f);
+  glm::vec2 r = point - (scale * id);
+  return glm::vec2(((int)id.x & 1) == 0 ? r.x : -r.x,
+                   ((int)id.y & 1) == 0 ? r.y : -r.y);
+}
+
+inline glm::vec3 sdfOpTwistY(glm::vec3 point, float amount) {
+  float c = glm::cos(amount * point.y);
+  float s = glm::sin(amount * point.y);
+  glm::mat3 rot(
+     c, 0, s,
+     0, 1, 0,
+    -s, 0, c);
+  return rot * point;
+}
+
+inline glm::vec2 sdfOpRepeat2D(glm::vec2 point, glm::vec2 scale) {
+  return point - (scale * glm::round(point / scale));
+}
+
+inline glm::vec2 sdfOpRepeat2DClamped(glm::vec2 point, glm::vec2 scale, glm::vec2 limit) {
+  return point - (scale * glm::clamp(glm::round(point / scale), -limit, limit));
+}
+
+inline float sdfOpSmoothMin(float a, float b, float k) {
+  k *= 4.0f;
+  float h = glm::max(k - glm::abs(a - b), 0.0f) / k;
+  return glm::min(a, b) - h * h * k * (1.0f / 4.0f);
+}
+
+inline float sdfSphere(glm::vec3 point, float radius) {
+  return glm::length(point) - radius;
+}
+
+inline float sdfBox(glm::vec3 point, glm::vec3 half_size) {
+  glm::vec3 q = glm::abs(point) - half_size;
+  return glm::length(glm::max(q, 0.0f)) + glm::min(glm::max(q.x, glm::max(q.y, q.z)), 0.0f);
+}
+
+inline float sdfHorseshoe2D(glm::vec2 point, glm::vec2 curve, float inner_radius, glm::vec2 arm_dimensions) {
+  point.x = glm::abs(point.x);
+  float l = glm::length(point);
+  point = glm::mat2(-curve.x, curve.y, curve.y, curve.x) * point;
+  point = glm::vec2(
+    (point.y > 0.0f || point.x > 0.0f) ? point.x : l * glm::sign(-curve.x),
+    (point.x > 0.0f) ? point.y : l
+  );
+  point = glm::vec2(point.x, glm::abs(point.y - inner_radius)) - arm_dimensions;
+  return glm::length(glm::max(point, 0.0f)) + glm::min(0.0f, glm::max(point.x, point.y));
+}
+
+inline float sdfCutSphere(glm::vec3 p, float r, float h) {
+  float w = glm::sqrt(r * r - h * h);
+
+  glm::vec2 q(glm::length(glm::vec2(p.x, p.z)), p.y);
+  float s = glm::max((h - r) * q.x * q.x + w * w * (h + r - 2.0f * q.y), h * q.x - w * q.y);
+  return (s < 0.0f) ? glm::length(q) - r :
+         (q.x < w)  ? h - q.y :
+                      glm::length(q - glm::vec2(w, h));
+}
+
+inline float sdfVerticalCapsule(glm::vec3 point, float height, float offset) {
+  point.y -= glm::clamp(point.y, 0.0f, height);
+  return glm::length(point) - offset;
+}
+
+inline float sdfCone(glm::vec3 point, glm::vec2 sc_angle, float height) {
+  float q = glm::length(glm::vec2(point.x, point.z));
+  return glm::max(glm::dot(sc_angle, glm::vec2(q, point.y)), -height - point.y);
+}
+
+inline float sdfVesica2D(glm::vec2 p, float r, float d) {
+  p = glm::abs(p);
+  float b = glm::sqrt(r * r - d * d);
+  return ((p.y - b) * d > p.x * b) ? glm::length(p - glm::vec2(0.0f, b))
+                                   : glm::length(p - glm::vec2(-d, 0.0f)) - r;
+}
+
+// Hash from gundam.glsl, unsigned arithmetic wraps like GLSL's. The
+// unsuffixed 0xEFFFFFFF literal is a GLSL int, so the scale is negative.
+inline glm::vec3 pcg3d(glm::vec3 seed) {
+  uint32_t v[3] = {(uint32_t)seed.x, (uint32_t)seed.y, (uint32_t)seed.z};
+  for (auto &x : v) x = x * 1664525u + 1013904223u;
+
+  v[0] += v[1] * v[2];
+  v[1] += v[2] * v[0];
+  v[2] += v[0] * v[1];
+
+  for (auto &x : v) x ^= x >> 16u;
+
+  v[0] += v[1] * v[2];
+  v[1] += v[2] * v[0];
+  v[2] += v[0] * v[1];
+
+  return glm::vec3((float)v[0], (float)v[1], (float)v[2]) * (1.0f / (float)(int32_t)0xEFFFFFFFu);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef CSCI_4110U_CPU_SIMD_H
+#define CSCI_4110U_CPU_SIMD_H
+
+#include <immintrin.h>
+
+/* A float per SIMD lane, the widest the translation unit is compiled for:
+   FloatN is 16 lanes with AVX-512F and 8 with AVX2. Comparisons give a
+   FloatN::Mask, select() picks per lane. Everything is in an anonymous
+   namespace: the kernels are built once per instruction set and must not
+   share inline functions, the linker would keep either copy.
+*/
+
+namespace {
+
+#if defined(__AVX512F__)
+
+struct FloatN {
+  static constexpr int width = 16;
+  using Mask = __mmask16;
+
+  __m512 v;
+
+  FloatN() = default;
+  FloatN(float value) : v(_mm512_set1_ps(value)) {}
+  explicit FloatN(__m512 value) : v(value) {}
+
+  static FloatN load(const float *p) { return FloatN(_mm512_loadu_ps(p)); }
+  void store(float *p) const { _mm512_storeu_ps(p, v); }
+};
+
+inline FloatN operator+(FloatN a, FloatN b) { return FloatN(_mm512_add_ps(a.v, b.v)); }
+inline FloatN operator-(FloatN a, FloatN b) { return FloatN(_mm512_sub_ps(a.v, b.v)); }
+inline FloatN operator*(FloatN a, FloatN b) { return FloatN(_mm512_mul_ps(a.v, b.v)); }
+inline FloatN operator/(FloatN a, FloatN b) { return FloatN(_mm512_div_ps(a.v, b.v)); }
+inline FloatN operator-(FloatN a) { return FloatN(_mm512_sub_ps(_mm512_setzero_ps(), a.v)); }
+
+inline FloatN::Mask operator<(FloatN a, FloatN b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+inline FloatN::Mask operator>(FloatN a, FloatN b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+inline FloatN::Mask operator>=(FloatN a, FloatN b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ); }
+inline FloatN::Mask operator==(FloatN a, FloatN b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ); }
+
+inline FloatN select(FloatN::Mask mask, FloatN a, FloatN b) { return FloatN(_mm512_mask_blend_ps(mask, b.v, a.v)); }
+inline bool any(FloatN::Mask mask) { return mask != 0; }
+inline FloatN::Mask maskFirst(int count) { return (FloatN::Mask)((1u << count) - 1u); }
+
+// The masked forms with every lane set: GCC 12 warns that the unmasked ones
+// read an uninitialised register.
+#define ALL_LANES ((__mmask16)0xFFFF)
+inline FloatN min(FloatN a, FloatN b) { return FloatN(_mm512_mask_min_ps(a.v, ALL_LANES, b.v, a.v)); }
+inline FloatN max(FloatN a, FloatN b) { return FloatN(_mm512_mask_max_ps(a.v, ALL_LANES, b.v, a.v)); }
+inline FloatN abs(FloatN a) { return FloatN(_mm512_abs_ps(a.v)); }
+inline FloatN sqrt(FloatN a) { return FloatN(_mm512_mask_sqrt_ps(a.v, ALL_LANES, a.v)); }
+inline FloatN floor(FloatN a) { return FloatN(_mm512_mask_roundscale_ps(a.v, ALL_LANES, a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)); }
+inline FloatN trunc(FloatN a) { return FloatN(_mm512_mask_roundscale_ps(a.v, ALL_LANES, a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)); }
+#undef ALL_LANES
+
+#elif defined(__AVX2__)
+
+// All bits set in true lanes. A struct, operators can not be overloaded on
+// __m256 itself.
+struct MaskN {
+  __m256 v;
+};
+
+struct FloatN {
+  static constexpr int width = 8;
+  using Mask = MaskN;
+
+  __m256 v;
+
+  FloatN() = default;
+  FloatN(float value) : v(_mm256_set1_ps(value)) {}
+  explicit FloatN(__m256 value) : v(value) {}
+
+  static FloatN load(const float *p) { return FloatN(_mm256_loadu_ps(p)); }
+  void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline FloatN operator+(FloatN a, FloatN b) { return FloatN(_mm256_add_ps(a.v, b.v)); }
+inline FloatN operator-(FloatN a, FloatN b) { return FloatN(_mm256_sub_ps(a.v, b.v)); }
+inline FloatN operator*(FloatN a, FloatN b) { return FloatN(_mm256_mul_ps(a.v, b.v)); }
+inline FloatN operator/(FloatN a, FloatN b) { return FloatN(_mm256_div_ps(a.v, b.v)); }
+inline FloatN operator-(FloatN a) { return FloatN(_mm256_sub_ps(_mm256_setzero_ps(), a.v)); }
+
+inline MaskN operator<(FloatN a, FloatN b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline MaskN operator>(FloatN a, FloatN b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline MaskN operator>=(FloatN a, FloatN b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+inline MaskN operator==(FloatN a, FloatN b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+
+inline MaskN operator&(MaskN a, MaskN b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline MaskN operator|(MaskN a, MaskN b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline MaskN operator~(MaskN a) { return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))}; }
+
+inline FloatN select(MaskN mask, FloatN a, FloatN b) { return FloatN(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+inline bool any(MaskN mask) { return _mm256_movemask_ps(mask.v) != 0; }
+inline MaskN maskFirst(int count) {
+  return {_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)))};
+}
+
+inline FloatN min(FloatN a, FloatN b) { return FloatN(_mm256_min_ps(b.v, a.v)); }
+inline FloatN max(FloatN a, FloatN b) { return FloatN(_mm256_max_ps(b.v, a.v)); }
+inline FloatN abs(FloatN a) { return FloatN(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+inline FloatN sqrt(FloatN a) { return FloatN(_mm256_sqrt_ps(a.v)); }
+inline FloatN floor(FloatN a) { return FloatN(_mm256_floor_ps(a.v)); }
+inline FloatN trunc(FloatN a) { return FloatN(_mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)); }
+
+#endif
+
+#if defined(__AVX2__)
+
+// The rest is the same for every width, glm's behaviour where it matters.
+
+inline FloatN clamp(FloatN a, FloatN lo, FloatN hi) { return min(max(a, lo), hi); }
+inline FloatN fract(FloatN a) { return a - floor(a); }
+inline FloatN sign(FloatN a) { return select(a > 0.0f, FloatN(1.0f), select(a < 0.0f, FloatN(-1.0f), FloatN(0.0f))); }
+
+// Halves away from zero like std::round, the vector instructions round them
+// to even.
+inline FloatN round(FloatN a) {
+  FloatN t = trunc(a);
+  return t + select(abs(a - t) >= 0.5f, sign(a), FloatN(0.0f));
+}
+
+// Cephes' sinf/cosf, within a couple of ulp of libm for |x| < 8192.
+inline void sincos(FloatN x, FloatN &s, FloatN &c) {
+  FloatN j = floor(x * 0.636619772f + 0.5f);  // Nearest multiple of pi/2.
+  FloatN r = ((x - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+  FloatN quadrant = j - 4.0f * floor(j * 0.25f);
+
+  FloatN r2 = r * r;
+  FloatN sin_r = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+  FloatN cos_r = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+  s = select(quadrant == 0.0f, sin_r, select(quadrant == 1.0f, cos_r, select(quadrant == 2.0f, -sin_r, -cos_r)));
+  c = select(quadrant == 0.0f, cos_r, select(quadrant == 1.0f, -sin_r, select(quadrant == 2.0f, -cos_r, sin_r)));
+}
+
+#endif
+
+}  // namespace
+
+#endif
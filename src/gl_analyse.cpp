@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gl_capture.hpp"
+
+/* Offline analysis of a --capture-gl trace.
+
+   Replays the state-setting calls against a model of the GL state and counts
+   the ones that set what is already set: binds of the bound object, enables
+   of enabled caps, uniform sets of the current value. Also counts
+   glGetUniformLocation queries that were answered before. State before the
+   first frame is unknown, the first set of anything is never redundant.
+*/
+
+struct Call {
+  uint16_t id;
+  uint32_t frame;
+  uint64_t start_ns;
+  uint32_t duration_ns;
+  std::vector<uint64_t> args;
+  std::string data;
+};
+
+struct FunctionStats {
+  int calls = 0;
+  int redundant = 0;
+  uint64_t time_ns = 0;
+};
+
+class Analysis {
+  // State key -> value. Keys are the function name plus the arguments that
+  // select the state (target, unit, location, ...).
+  std::map<std::string, std::string> state{};
+  std::map<std::tuple<uint64_t, std::string>, uint64_t> locations{};
+  uint64_t active_texture = GL_TEXTURE0;
+  uint64_t program = 0;
+
+  bool set(const std::string &key, const std::string &value) {
+    auto found = state.find(key);
+    bool same = found != state.end() && found->second == value;
+    state[key] = value;
+    return same;
+  }
+
+  static std::string key(const char *name, uint64_t a) {
+    return std::string(name) + ":" + std::to_string(a);
+  }
+
+  static std::string key(const char *name, uint64_t a, uint64_t b) {
+    return key(name, a) + ":" + std::to_string(b);
+  }
+
+  static std::string value(const std::vector<uint64_t> &args, size_t from, const std::string &data = {}) {
+    std::string str;
+    for (size_t i = from; i < args.size(); i++) str += std::to_string(args[i]) + ",";
+    return str + data;
+  }
+
+  public:
+    int repeated_locations = 0;
+
+    // Returns true if the call changed nothing.
+    bool redundant(const std::string &name, const Call &call) {
+      auto &args = call.args;
+      if (args.empty()) return false;
+
+      if (name == "glBindVertexArray") return set("vao", value(args, 0));
+      if (name == "glUseProgram") {
+        program = args[0];
+        return set("program", value(args, 0));
+      }
+      if (name == "glActiveTexture") {
+        active_texture = args[0];
+        return set("active_texture", value(args, 0));
+      }
+      if (name == "glBindTexture") return set(key("texture", active_texture, args[0]), value(args, 1));
+      if (name == "glBindBuffer") return set(key("buffer", args[0]), value(args, 1));
+      if (name == "glBindBufferBase" && args.size() == 3) return set(key("buffer_base", args[0], args[1]), value(args, 2));
+      if (name == "glBindRenderbuffer") return set(key("renderbuffer", args[0]), value(args, 1));
+      if (name == "glBindSampler") return set(key("sampler", args[0]), value(args, 1));
+      if (name == "glPixelStorei") return set(key("pixel_store", args[0]), value(args, 1));
+      if (name == "glViewport") return set("viewport", value(args, 0));
+      if (name == "glEnable") return set(key("cap", args[0]), "1");
+      if (name == "glDisable") return set(key("cap", args[0]), "0");
+      if (name == "glBindFramebuffer" && args.size() == 2) {
+        auto fbo = value(args, 1);
+        if (args[0] == GL_DRAW_FRAMEBUFFER) return set("draw_framebuffer", fbo);
+        if (args[0] == GL_READ_FRAMEBUFFER) return set("read_framebuffer", fbo);
+        bool draw = set("draw_framebuffer", fbo);
+        bool read = set("read_framebuffer", fbo);
+        return draw && read;
+      }
+      if (name.rfind("glUniform", 0) == 0) {
+        // Uniforms belong to the program in use, the location is the first
+        // argument and everything after it is the value. Arrays are compared
+        // by their contents, the pointer is left out.
+        std::vector<uint64_t> values{args.begin(), args.end() - (call.data.empty() ? 0 : 1)};
+        return set(key("uniform", program, args[0]), value(values, 1, call.data) + name);
+      }
+      if (name == "glGetUniformLocation" && args.size() == 3) {
+        auto query = std::make_tuple(args[0], call.data);
+        bool seen = locations.count(query) > 0;
+        locations[query] = args[2];
+        if (seen) repeated_locations++;
+        return seen;
+      }
+      return false;
+    }
+};
+
+template<typename T>
+static bool read(std::ifstream &file, T &value) {
+  return (bool)file.read((char *)&value, sizeof(T));
+}
+
+static void printUsage() {
+  std::printf("Usage: final-analyse CAPTURE\n");
+  std::printf("  Reports call counts and redundant state changes of a --capture-gl trace.\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2 || std::strcmp(argv[1], "--help") == 0) {
+    printUsage();
+    return argc == 2 ? 0 : -1;
+  }
+
+  std::ifstream file{argv[1], std::ios::binary};
+  char magic[4];
+  uint32_t version = 0;
+  if (!file.read(magic, 4) || std::string(magic, 4) != GL_CAPTURE_MAGIC || !read(file, version)) {
+    std::fprintf(stderr, "%s is not a GL capture!\n", argv[1]);
+    return -1;
+  }
+  if (version != GL_CAPTURE_VERSION) {
+    std::fprintf(stderr, "%s has version %u, expected %d!\n", argv[1], version, GL_CAPTURE_VERSION);
+    return -1;
+  }
+
+  std::vector<std::string> names;
+  std::vector<FunctionStats> stats;
+  Analysis analysis;
+  uint32_t frames = 0;
+  uint64_t total_calls = 0;
+
+  uint8_t kind;
+  while (read(file, kind)) {
+    if (kind == GL_CAPTURE_NAME) {
+      uint16_t id, length;
+      if (!read(file, id) || !read(file, length)) break;
+      std::string name(length, '\0');
+      if (!file.read(name.data(), length)) break;
+      if (id >= names.size()) {
+        names.resize(id + 1);
+        stats.resize(id + 1);
+      }
+      names[id] = name;
+      continue;
+    }
+    if (kind != GL_CAPTURE_CALL) {
+      std::fprintf(stderr, "Unknown record %u, stopping.\n", kind);
+      break;
+    }
+
+    Call call;
+    uint8_t count;
+    uint32_t length;
+    if (!read(file, call.id) || !read(file, call.frame) || !read(file, call.start_ns)
+        || !read(file, call.duration_ns) || !read(file, count)) break;
+    call.args.resize(count);
+    for (auto &arg : call.args) read(file, arg);
+    if (!read(file, length)) break;
+    call.data.resize(length);
+    if (!file.read(call.data.data(), length) || call.id >= names.size()) break;
+
+    auto &function = stats[call.id];
+    function.calls++;
+    function.time_ns += call.duration_ns;
+    if (analysis.redundant(names[call.id], call)) function.redundant++;
+    frames = std::max(frames, call.frame + 1);
+    total_calls++;
+  }
+
+  if (frames == 0) {
+    std::fprintf(stderr, "%s has no calls.\n", argv[1]);
+    return -1;
+  }
+
+  std::vector<int> order(names.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](int a, int b) { return stats[a].calls > stats[b].calls; });
+
+  int total_redundant = 0;
+  std::printf("%u frames, %.1f calls per frame\n\n", frames, (double)total_calls / frames);
+  std::printf("%-28s %10s %12s %12s\n", "Function", "Calls/frame", "Redundant/f", "us/frame");
+  for (int i : order) {
+    auto &function = stats[i];
+    total_redundant += function.redundant;
+    std::printf("%-28s %10.1f %12.1f %12.2f\n", names[i].c_str(),
+      (double)function.calls / frames, (double)function.redundant / frames,
+      function.time_ns / 1.0e3 / frames);
+  }
+
+  std::printf("\nRedundant calls: %.1f per frame (%.1f%% of all calls)\n",
+    (double)total_redundant / frames, 100.0 * total_redundant / total_calls);
+  std::printf("Repeated glGetUniformLocation queries: %.1f per frame\n",
+    (double)analysis.repeated_locations / frames);
+}
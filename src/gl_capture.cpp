@@ -0,0 +1,211 @@
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include "gl_capture.hpp"
+
+/* Argument types of the captured calls, in order:
+     i  32-bit integer (enum, int, uint, sizei, boolean, bitfield)
+     l  64-bit integer (intptr, sizeiptr)
+     f  float
+     p  pointer, only the address is kept
+     s  string, copied into the data
+     vN pointer to count * N floats, count being the second argument
+     wN pointer to count * N integers
+     =i return value, an integer
+   Calls that are not listed are recorded without arguments.
+*/
+static const std::unordered_map<std::string, const char *> signatures{
+  {"glActiveTexture", "i"},
+  {"glBindBuffer", "ii"},
+  {"glBindBufferBase", "iii"},
+  {"glBindBufferRange", "iiill"},
+  {"glBindFramebuffer", "ii"},
+  {"glBindRenderbuffer", "ii"},
+  {"glBindSampler", "ii"},
+  {"glBindTexture", "ii"},
+  {"glBindVertexArray", "i"},
+  {"glBlitFramebuffer", "iiiiiiiiii"},
+  {"glBufferSubData", "illp"},
+  {"glClear", "i"},
+  {"glDisable", "i"},
+  {"glDrawArrays", "iii"},
+  {"glDrawBuffers", "ip"},
+  {"glEnable", "i"},
+  {"glGetUniformLocation", "is=i"},
+  {"glPixelStorei", "ii"},
+  {"glUniform1f", "if"},
+  {"glUniform2f", "iff"},
+  {"glUniform3f", "ifff"},
+  {"glUniform4f", "iffff"},
+  {"glUniform1i", "ii"},
+  {"glUniform2i", "iii"},
+  {"glUniform3i", "iiii"},
+  {"glUniform4i", "iiiii"},
+  {"glUniform1ui", "ii"},
+  {"glUniform1fv", "iiv1"},
+  {"glUniform2fv", "iiv2"},
+  {"glUniform3fv", "iiv3"},
+  {"glUniform4fv", "iiv4"},
+  {"glUniform1iv", "iiw1"},
+  {"glUniformMatrix3fv", "iiiv9"},
+  {"glUniformMatrix4fv", "iiiv16"},
+  {"glUseProgram", "i"},
+  {"glViewport", "iiii"},
+};
+
+struct CapturedFunction {
+  uint16_t id;
+  const char *signature;
+};
+
+// Keyed by glad's name literals, each function always passes the same one.
+static std::unordered_map<const char *, CapturedFunction> functions{};
+
+bool GlCapture::recording = false;
+std::ofstream GlCapture::file{};
+std::vector<char> GlCapture::buffer{};
+int GlCapture::frame = 0;
+int GlCapture::frames = 0;
+uint64_t GlCapture::origin = 0;
+uint64_t GlCapture::call_start = 0;
+GLADpostcallback GlCapture::error_check = nullptr;
+
+template<typename T>
+static void put(std::vector<char> &buffer, const T &value) {
+  auto bytes = (const char *)&value;
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+uint64_t GlCapture::now() {
+  auto time = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() - origin;
+}
+
+void GlCapture::flush() {
+  file.write(buffer.data(), buffer.size());
+  buffer.clear();
+}
+
+void GlCapture::start(const std::string &path, int capture_frames) {
+  file.open(path, std::ios::binary);
+  if (!file) {
+    spdlog::error("GL capture: Could not open {} for writing!", path);
+    return;
+  }
+
+  file.write(GL_CAPTURE_MAGIC, 4);
+  uint32_t version = GL_CAPTURE_VERSION;
+  file.write((const char *)&version, sizeof(version));
+
+  functions.clear();
+  buffer.reserve(1 << 20);
+  frame = 0;
+  frames = capture_frames;
+  origin = 0;
+  origin = now();
+  recording = true;
+  spdlog::info("GL capture: Recording {} frames to {}", frames, path);
+}
+
+void GlCapture::install(GLADpostcallback check) {
+  error_check = check;
+  gladSetGLPreCallback(&preCall);
+  gladSetGLPostCallback(&postCall);
+}
+
+void GlCapture::preCall(const char *, GLADapiproc, int, ...) {
+  if (error_check) glad_glGetError();  // Same as glad's default, errors belong to the next call.
+  call_start = now();
+}
+
+void GlCapture::postCall(void *ret, const char *name, GLADapiproc proc, int len_args, ...) {
+  uint64_t end = now();
+
+  auto found = functions.find(name);
+  if (found == functions.end()) {
+    auto signature = signatures.find(name);
+    CapturedFunction function{
+      .id = (uint16_t)functions.size(),
+      .signature = signature == signatures.end() ? "" : signature->second,
+    };
+    found = functions.emplace(name, function).first;
+
+    uint16_t length = std::strlen(name);
+    put(buffer, (uint8_t)GL_CAPTURE_NAME);
+    put(buffer, function.id);
+    put(buffer, length);
+    buffer.insert(buffer.end(), name, name + length);
+  }
+
+  uint64_t args[16];
+  int argc = 0;
+  static std::vector<char> data;
+  data.clear();
+  va_list list;
+  va_start(list, len_args);
+  for (const char *c = found->second.signature; *c && argc < 16; c++) {
+    switch (*c) {
+      case 'i': args[argc++] = (uint32_t)va_arg(list, int); break;
+      case 'l': args[argc++] = (uint64_t)va_arg(list, long long); break;
+      case 'f': {
+        double value = va_arg(list, double);  // Promoted from float.
+        std::memcpy(&args[argc++], &value, sizeof(value));
+        break;
+      }
+      case 'p': args[argc++] = (uintptr_t)va_arg(list, const void *); break;
+      case 's': {
+        auto str = va_arg(list, const char *);
+        args[argc++] = (uintptr_t)str;
+        if (str) data.insert(data.end(), str, str + std::strlen(str));
+        break;
+      }
+      case 'v':
+      case 'w': {
+        auto values = va_arg(list, const char *);
+        args[argc++] = (uintptr_t)values;
+        size_t count = argc > 2 ? args[1] : 1;
+        size_t components = std::strtoul(c + 1, nullptr, 10);
+        if (values) data.insert(data.end(), values, values + count * components * 4);
+        while (c[1] >= '0' && c[1] <= '9') c++;
+        break;
+      }
+      case '=':
+        if (ret && c[1] == 'i') args[argc++] = (uint32_t)*(GLint *)ret;
+        c++;
+        break;
+    }
+  }
+  va_end(list);
+
+  put(buffer, (uint8_t)GL_CAPTURE_CALL);
+  put(buffer, found->second.id);
+  put(buffer, (uint32_t)frame);
+  put(buffer, call_start);
+  put(buffer, (uint32_t)(end - call_start));
+  put(buffer, (uint8_t)argc);
+  for (int i = 0; i < argc; i++) put(buffer, args[i]);
+  put(buffer, (uint32_t)data.size());
+  buffer.insert(buffer.end(), data.begin(), data.end());
+
+  if (error_check) {
+    // Arguments are not forwarded, the error check only uses the name.
+    error_check(ret, name, proc, 0);
+  }
+}
+
+bool GlCapture::endFrame() {
+  if (!recording) return false;
+
+  flush();
+  if (++frame < frames) return false;
+
+  recording = false;
+  file.close();
+  spdlog::info("GL capture: {} frames, {} functions", frames, functions.size());
+  return true;
+}
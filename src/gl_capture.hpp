@@ -0,0 +1,56 @@
+#ifndef CSCI_4110U_GL_CAPTURE_H
+#define CSCI_4110U_GL_CAPTURE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <GL/gl.h>
+
+/* GL call capture through glad's debug callbacks.
+
+   Every GL call of the next `frames` frames is written to a binary trace:
+   name, start time, duration and, for the calls in the signature table
+   (binds, uniforms, state), the arguments. Uniform arrays and strings are
+   copied so that repeated values can be found offline by final-analyse.
+
+   File layout, native byte order:
+     "GLCT" u32 version
+     NAME: u8 1, u16 id, u16 length, name
+     CALL: u8 2, u16 id, u32 frame, u64 start_ns, u32 duration_ns,
+           u8 argc, argc * u64 args, u32 length, data
+   Integer arguments are zero extended, floats are stored as doubles, the
+   return value (when recorded) is the last argument.
+*/
+
+#define GL_CAPTURE_MAGIC "GLCT"
+#define GL_CAPTURE_VERSION 1
+#define GL_CAPTURE_NAME 1
+#define GL_CAPTURE_CALL 2
+
+class GlCapture {
+  static bool recording;
+  static std::ofstream file;
+  static std::vector<char> buffer;
+  static int frame;
+  static int frames;
+  static uint64_t origin;
+  static uint64_t call_start;
+  static GLADpostcallback error_check;
+
+  static uint64_t now();
+  static void flush();
+  static void preCall(const char *name, GLADapiproc proc, int len_args, ...);
+  static void postCall(void *ret, const char *name, GLADapiproc proc, int len_args, ...);
+
+  public:
+    static void start(const std::string &path, int frames);
+    static bool active() { return recording; }
+    // Takes over glad's callbacks, `check` (may be null) still runs after every call.
+    static void install(GLADpostcallback check);
+    // Call once per frame, returns true when the capture just finished.
+    static bool endFrame();
+};
+
+#endif
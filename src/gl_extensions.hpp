@@ -0,0 +1,18 @@
+#ifndef CSCI_4110U_GL_EXTENSIONS_H
+#define CSCI_4110U_GL_EXTENSIONS_H
+
+#include <string>
+
+#include <GL/gl.h>
+
+// Whether the current context reports the extension, e.g. "GL_ARB_shader_clock".
+inline bool hasExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    if (std::string((const char *)glGetStringi(GL_EXTENSIONS, i)) == name) return true;
+  }
+  return false;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "gpu_timer.hpp"
+#include "trace.hpp"
+
+GpuTimer::GpuTimer(std::vector<std::string> pass_names) : pass_names(pass_names) {
+  for (auto &frame : frames) {
+    frame.queries.resize(pass_names.size() + 1);
+    glGenQueries(frame.queries.size(), frame.queries.data());
+  }
+  history.resize(pass_names.size(), std::vector<float>(HISTORY_SIZE, 0.0f));
+}
+
+GpuTimer::~GpuTimer() {
+  for (auto &frame : frames) {
+    glDeleteQueries(frame.queries.size(), frame.queries.data());
+  }
+}
+
+void GpuTimer::collect(Frame &frame) {
+  frame.pending = false;
+  if (frame.marked != (int)frame.queries.size()) return;  // Incomplete frame.
+
+  // Queries complete in order, the last one being ready implies the rest are.
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(frame.queries.back(), GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE) return;
+
+  GLuint64 previous, timestamp;
+  glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &previous);
+  for (size_t pass = 0; pass < pass_names.size(); pass++) {
+    glGetQueryObjectui64v(frame.queries[pass + 1], GL_QUERY_RESULT, &timestamp);
+    history[pass][history_head] = (timestamp - previous) / 1.0e6f;
+    if (Trace::active()) Trace::gpu(pass_names[pass], previous, timestamp);
+    previous = timestamp;
+  }
+
+  history_head = (history_head + 1) % HISTORY_SIZE;
+  if (history_count < HISTORY_SIZE) history_count++;
+}
+
+void GpuTimer::beginFrame() {
+  Frame &frame = frames[current];
+  if (frame.pending) collect(frame);
+
+  frame.marked = 1;
+  glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+  if (Trace::active()) Trace::begin(pass_names[0]);
+}
+
+void GpuTimer::endPass(int pass) {
+  Frame &frame = frames[current];
+  glQueryCounter(frame.queries[pass + 1], GL_TIMESTAMP);
+  frame.marked++;
+
+  // CPU side of the pass, next to the GPU one in the trace.
+  if (Trace::active()) {
+    Trace::end();
+    if (pass + 1 < passCount()) Trace::begin(pass_names[pass + 1]);
+  }
+}
+
+void GpuTimer::endFrame() {
+  frames[current].pending = true;
+  current = (current + 1) % RING_SIZE;
+}
+
+float GpuTimer::latest(int pass) const {
+  if (history_count == 0) return 0.0f;
+  return history[pass][(history_head + HISTORY_SIZE - 1) % HISTORY_SIZE];
+}
+
+float GpuTimer::average(int pass) const {
+  if (history_count == 0) return 0.0f;
+
+  float sum = 0.0f;
+  for (int i = 0; i < history_count; i++) {
+    sum += history[pass][(history_head + HISTORY_SIZE - 1 - i) % HISTORY_SIZE];
+  }
+  return sum / history_count;
+}
@@ -0,0 +1,57 @@
+#ifndef CSCI_4110U_GPU_TIMER_H
+#define CSCI_4110U_GPU_TIMER_H
+
+#include <string>
+#include <vector>
+
+#include <GL/gl.h>
+
+/* Times consecutive GPU passes with GL_TIMESTAMP queries.
+
+   Each frame writes one timestamp at the start and one at the end of every
+   pass. Results are read back RING_SIZE frames later, by which point the GPU
+   has almost always finished them. A frame whose results are still not
+   available is dropped rather than waited on, so the CPU never stalls.
+
+   While a Trace is recording, passes are also traced on the CPU (from one
+   endPass to the next) and on the GPU.
+*/
+class GpuTimer {
+  static constexpr int RING_SIZE = 4;
+  static constexpr int HISTORY_SIZE = 120;
+
+  struct Frame {
+    std::vector<GLuint> queries{};  // passes + 1 timestamps.
+    int marked = 0;
+    bool pending = false;
+  };
+
+  std::vector<std::string> pass_names;
+  Frame frames[RING_SIZE];
+  int current = 0;
+
+  std::vector<std::vector<float>> history;  // Per pass, milliseconds.
+  int history_head = 0;
+  int history_count = 0;
+
+  void collect(Frame &frame);
+
+  public:
+    GpuTimer(std::vector<std::string> pass_names);
+    ~GpuTimer();
+
+    void beginFrame();
+    void endPass(int pass);
+    void endFrame();
+
+    int passCount() const { return pass_names.size(); }
+    const std::string &passName(int pass) const { return pass_names[pass]; }
+    float latest(int pass) const;
+    float average(int pass) const;
+    // Ring buffer of the last HISTORY_SIZE samples, oldest at `historyOffset`.
+    const float *historyData(int pass) const { return history[pass].data(); }
+    int historySize() const { return HISTORY_SIZE; }
+    int historyOffset() const { return history_head; }
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "input_recording.hpp"
+
+#define RECORDING_MAGIC "SDFI"
+#define RECORDING_VERSION 1
+
+template<typename T>
+static void write(std::ofstream &file, const T &value) {
+  file.write((const char *)&value, sizeof(T));
+}
+
+template<typename T>
+static bool read(std::ifstream &file, T &value) {
+  return (bool)file.read((char *)&value, sizeof(T));
+}
+
+InputRecorder::InputRecorder(const std::string &path) : file(path, std::ios::binary), path(path) {
+  if (!file) {
+    spdlog::error("Recording: Could not open {} for writing!", path);
+    throw std::runtime_error("InputRecorder");
+  }
+
+  file.write(RECORDING_MAGIC, 4);
+  write(file, (uint32_t)RECORDING_VERSION);
+}
+
+InputRecorder::~InputRecorder() {
+  spdlog::info("Recording: {} frames -> {}", frames, path);
+}
+
+void InputRecorder::record(const FrameInput &input) {
+  for (float value : input.mouse) write(file, value);
+  write(file, input.time);
+  write(file, input.time_delta);
+  write(file, input.anaglyph);
+  write(file, input.scene_id);
+  frames++;
+}
+
+InputReplay::InputReplay(const std::string &path) {
+  std::ifstream file{path, std::ios::binary};
+  char magic[4];
+  uint32_t version = 0;
+  if (!file.read(magic, 4) || std::string(magic, 4) != RECORDING_MAGIC || !read(file, version)) {
+    spdlog::error("Replay: {} is not an input recording!", path);
+    throw std::runtime_error("InputReplay");
+  }
+  if (version != RECORDING_VERSION) {
+    spdlog::error("Replay: {} has version {}, expected {}!", path, version, RECORDING_VERSION);
+    throw std::runtime_error("InputReplay");
+  }
+
+  // Records run to the end of the file, a partial last record is dropped.
+  FrameInput input;
+  while (read(file, input.mouse[0]) && read(file, input.mouse[1]) && read(file, input.mouse[2])
+         && read(file, input.time) && read(file, input.time_delta)
+         && read(file, input.anaglyph) && read(file, input.scene_id)) {
+    inputs.push_back(input);
+  }
+  spdlog::info("Replay: {} frames from {}", inputs.size(), path);
+}
@@ -0,0 +1,46 @@
+#ifndef CSCI_4110U_INPUT_RECORDING_H
+#define CSCI_4110U_INPUT_RECORDING_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Everything a frame of the scene shaders depends on besides resolution. */
+struct FrameInput {
+  float mouse[3];  // imouse: x, y, left button.
+  float time;      // itime
+  float time_delta;
+  int32_t anaglyph;
+  int32_t scene_id;
+};
+
+/* Input recordings: a small header followed by one fixed-size record per
+   frame. Fields are written one by one in native byte order, the files are
+   for comparing builds on the same machine rather than for exchange.
+*/
+class InputRecorder {
+  std::ofstream file;
+  std::string path;
+  uint32_t frames = 0;
+
+  public:
+    InputRecorder(const std::string &path);
+    ~InputRecorder();
+
+    void record(const FrameInput &input);
+};
+
+class InputReplay {
+  std::vector<FrameInput> inputs{};
+  size_t next_frame = 0;
+
+  public:
+    InputReplay(const std::string &path);
+
+    bool done() const { return next_frame >= inputs.size(); }
+    size_t frameCount() const { return inputs.size(); }
+    const FrameInput &next() { return inputs[next_frame++]; }
+};
+
+#endif
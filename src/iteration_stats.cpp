@@ -0,0 +1,104 @@
+#include <algorithm>
+
+#include "iteration_stats.hpp"
+
+IterationStats::IterationStats(int max_iterations) : max_iterations(max_iterations) {
+  stats.histogram.resize(max_iterations + 1, 0.0f);
+  for (auto &readback : readbacks) {
+    glGenBuffers(1, &readback.pbo);
+  }
+}
+
+IterationStats::~IterationStats() {
+  for (auto &readback : readbacks) {
+    if (readback.fence) glDeleteSync(readback.fence);
+    glDeleteBuffers(1, &readback.pbo);
+  }
+}
+
+void IterationStats::setMaxIterations(int max_iterations) {
+  this->max_iterations = max_iterations;
+  stats.histogram.assign(max_iterations + 1, 0.0f);
+}
+
+void IterationStats::resize(int width, int height) {
+  this->width = width;
+  this->height = height;
+
+  // Drop readbacks of the old size.
+  for (auto &readback : readbacks) {
+    if (readback.fence) glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, width * height * sizeof(GLushort), nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  head = 0;
+  tail = 0;
+}
+
+void IterationStats::readback(GLuint fbo, GLenum attachment) {
+  poll();
+
+  Readback &readback = readbacks[head];
+  if (readback.fence) return;  // Ring is full, skip this frame.
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+  glReadBuffer(attachment);
+  glPixelStorei(GL_PACK_ALIGNMENT, 2);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+  glReadPixels(0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  head = (head + 1) % RING_SIZE;
+}
+
+bool IterationStats::poll() {
+  bool updated = false;
+
+  while (readbacks[tail].fence) {
+    Readback &readback = readbacks[tail];
+    GLenum status = glClientWaitSync(readback.fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    tail = (tail + 1) % RING_SIZE;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    auto pixels = (const GLushort *)glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, width * height * sizeof(GLushort), GL_MAP_READ_BIT
+    );
+    if (pixels) {
+      compute(pixels);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      updated = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+
+  return updated;
+}
+
+void IterationStats::compute(const GLushort *pixels) {
+  std::vector<unsigned> counts(max_iterations + 1, 0);
+  size_t pixel_count = (size_t)width * height;
+  unsigned long long total = 0;
+  int max = 0;
+
+  for (size_t i = 0; i < pixel_count; i++) {
+    int steps = std::min((int)pixels[i], max_iterations);
+    counts[steps]++;
+    total += steps;
+    max = std::max(max, steps);
+  }
+
+  stats.mean = pixel_count ? (double)total / pixel_count : 0.0;
+  stats.max = max;
+  stats.max_fraction = pixel_count ? (double)counts[max_iterations] / pixel_count : 0.0;
+  for (int i = 0; i <= max_iterations; i++) {
+    stats.histogram[i] = pixel_count ? (float)counts[i] / pixel_count : 0.0f;
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef CSCI_4110U_ITERATION_STATS_H
+#define CSCI_4110U_ITERATION_STATS_H
+
+#include <vector>
+
+#include <GL/gl.h>
+
+struct IterationFrameStats {
+  double mean = 0.0;
+  int max = 0;
+  double max_fraction = 0.0;     // Fraction of pixels that hit MAX_ITERATIONS.
+  std::vector<float> histogram;  // Fraction of pixels per step count.
+};
+
+/* Reads the per-pixel ray march step counts (GL_R16UI) back to the CPU.
+
+   Each readback is a glReadPixels into one of RING_SIZE pixel buffer objects
+   followed by a fence. Buffers are only mapped once their fence has
+   signalled, and a frame is skipped when every buffer is still in flight, so
+   the CPU never waits on the GPU.
+*/
+class IterationStats {
+  static constexpr int RING_SIZE = 3;
+
+  struct Readback {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+  };
+
+  int max_iterations;
+  int width = 0;
+  int height = 0;
+  Readback readbacks[RING_SIZE];
+  int head = 0;  // Next buffer to read into.
+  int tail = 0;  // Oldest buffer in flight.
+  IterationFrameStats stats{};
+
+  void compute(const GLushort *pixels);
+
+  public:
+    IterationStats(int max_iterations);
+    ~IterationStats();
+
+    void resize(int width, int height);
+    void setMaxIterations(int max_iterations);  // Of the shader in use.
+    void readback(GLuint fbo, GLenum attachment);
+    bool poll();
+
+    const IterationFrameStats &latest() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef CSCI_4110U_MAGNEMITE_SDF_H
+#define CSCI_4110U_MAGNEMITE_SDF_H
+
+#include <glm/glm.hpp>
+
+#include "cpu_scenes.hpp"
+#include "sdf_dsl.hpp"
+
+/* MagnemiteScene written with sdf_dsl.hpp, part for part and with the same
+   materials and colours. Built once per frame with float time for the CPU,
+   and with GlslFloat time "itime" by final-sdfgen for
+   shaders/magnemite-sdf.glsl. Parameters that depend on time must be T.
+*/
+
+template<typename T>
+sdf::Affine<T> magnemiteTransform(T time) {
+  using namespace sdf;
+  const float ANIMATION_DURATION = 2;
+
+  T ty = sin(time * 2) * 0.1f;
+  T ss = sin(time * CPU_PI / ANIMATION_DURATION);
+  T square_wave = max(sign(ss), 0.0f);
+  T tz = -0.5f * ss * square_wave;
+
+  // Spins every other animation, 1 or 0.
+  T spin = mod(floor(time / ANIMATION_DURATION), 2.0f);
+  T s = spin * sin(time * 2 * CPU_PI);
+  T c = spin * cos(time * 2 * CPU_PI) + (1.0f - spin);
+
+  // vec4(point, 1) * (translation * rotation) of the shader.
+  return {
+    .rows = {{c, s, 0.0f}, {-s, c, 0.0f}, {0.0f, 0.0f, 1.0f}},
+    .offset = {ty * s, ty * c, tz},
+  };
+}
+
+// point * a * b, as rows of one transform.
+inline sdf::Affine<float> magnemiteRotations(glm::mat3 a, glm::mat3 b) {
+  glm::mat3 m = a * b;
+  return {
+    .rows = {{m[0][0], m[0][1], m[0][2]}, {m[1][0], m[1][1], m[1][2]}, {m[2][0], m[2][1], m[2][2]}},
+    .offset = {0.0f, 0.0f, 0.0f},
+  };
+}
+
+inline auto magnemiteScrewBottom(float body_radius, float screw_twist, glm::vec3 half_size) {
+  using namespace sdf;
+
+  auto body = twistY(screw_twist, translate(0.0f, body_radius + half_size.y - 0.01f, 0.0f,
+                                            round(0.002f, box(half_size.x, half_size.y, half_size.z))));
+  auto head = translate(0.0f, body_radius + half_size.y - 0.055f, 0.0f, round(0.003f, cutSphere(0.09f, 0.08f)));
+  auto hole = translate(0.0f, 0.215f, 0.0f, box(0.030f, 0.013f, 0.010f) | box(0.010f, 0.013f, 0.030f));
+  return (body | head) - hole;
+}
+
+template<typename T>
+auto magnemiteSdf(T time) {
+  using namespace sdf;
+
+  float body_radius = 0.15f;
+  Eye<float> eye{
+    .base = {0.05f, 0.10f, 0.20f},
+    .pupil = {0.005f, 0.005f, 0.005f},
+    .sclera = {0.2f, 0.2f, 0.2f},
+    .pupil_cos = 0.995f,
+    .sclera_cos = 0.9f,
+    .outline_cos = 0.89f,
+  };
+  auto body = material(1, eye, sphere(body_radius));
+
+  float arm_curve = CPU_PI / 2;
+  float arm_radius = 0.05f;
+  float arm_thickness = 0.02f;
+  float arm_length = 0.10f;
+  // Horseshoe in the arm's frame: mirrored, moved out, turned a quarter.
+  Affine<float> quarter_turn{.rows = {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}}, .offset = {0, 0, 0}};
+  auto arms = material(2, flat(0.05f, 0.07f, 0.10f),
+    mirror<SDF_X>(translate(body_radius + arm_radius + arm_thickness, 0.0f, 0.0f,
+      transform(quarter_turn, extrude(arm_thickness,
+        horseshoe2D(glm::cos(arm_curve), glm::sin(arm_curve), arm_radius, arm_length, arm_thickness))))));
+
+  float tips_half_size = arm_thickness;
+  float tips_x = body_radius + arm_radius + arm_length + (2 * arm_thickness);
+  float tips_y = arm_radius + ((arm_thickness - tips_half_size) / 2);
+  auto tips = mirror<SDF_X, SDF_Y>(
+    material(3, flat(0.15f, 0.02f, 0.02f), translate(tips_x, tips_y, 0.0f, box(tips_half_size, tips_half_size, tips_half_size))) |
+    material(4, flat(0.02f, 0.02f, 0.15f), translate(tips_x, -tips_y, 0.0f, box(tips_half_size, tips_half_size, tips_half_size))));
+
+  auto screw_colour = flat(0.08f, 0.10f, 0.12f);
+  glm::vec3 screw_half_size(0.02f, body_radius * 0.3f, 0.02f);
+  float screw_twist = 100;
+  auto screw_body = twistY(screw_twist, translate(0.0f, body_radius + screw_half_size.y - 0.01f, 0.0f,
+    round(0.002f, box(screw_half_size.x, screw_half_size.y, screw_half_size.z))));
+  auto screw_head = translate(0.0f, body_radius + screw_half_size.y - 0.035f, 0.0f, round(0.003f, cutSphere(0.1f, 0.08f)));
+  auto screw_hole = translate(0.0f, 0.25f, 0.0f, box(0.040f, 0.013f, 0.013f) | box(0.013f, 0.013f, 0.040f));
+  auto screw_top = material(5, screw_colour, (screw_body | screw_head) - screw_hole);
+
+  glm::vec3 screwb_half_size(0.012f, body_radius * 0.2f, 0.012f);
+  float c1 = glm::cos(CPU_PI * 1 / 8);
+  float s1 = glm::sin(CPU_PI * 1 / 8);
+  float c5 = glm::cos(CPU_PI * 5 / 8);
+  float s5 = glm::sin(CPU_PI * 5 / 8);
+  glm::mat3 tilt(1, 0, 0, 0, c5, s5, 0, -s5, c5);
+  auto screwb_left = material(5, screw_colour, translate(-body_radius / 3, 0.0f, -0.02f,
+    transform(magnemiteRotations(glm::mat3(c1, 0, s1, 0, 1, 0, -s1, 0, c1), tilt),
+              magnemiteScrewBottom(body_radius, screw_twist, screwb_half_size))));
+  auto screwb_right = material(5, screw_colour, translate(body_radius / 3, 0.0f, -0.02f,
+    transform(magnemiteRotations(glm::mat3(c1, 0, -s1, 0, 1, 0, s1, 0, c1), tilt),
+              magnemiteScrewBottom(body_radius, screw_twist, screwb_half_size))));
+
+  // Body as the bounding volume of the rest.
+  auto magnemite = transform(magnemiteTransform(time),
+    bound(1.0f, body, arms | tips | screw_top | screwb_left | screwb_right));
+
+  auto blade = extrude(0.02f, round(0.25f, vesica2D(0.5f, 0.707f)));
+  auto tuft = translate(0.0f, -0.8f, 0.0f,
+    repeatClamped(0.1f, 1.0f, blade) |
+    mirror<SDF_X>(translate(0.19f, 0.0f, 0.0f, blade)) |
+    mirror<SDF_Z>(translate(0.0f, 0.0f, 0.19f, blade)));
+  T bend_factor = sin(time / 2);
+  Affine<float> grass_rot{.rows = {{5 / 13.0f, 0, -12 / 13.0f}, {0, 1, 0}, {12 / 13.0f, 0, 5 / 13.0f}}, .offset = {0, 0, 0}};
+  auto grass = material(6, flat(0.04f, 0.20f, 0.02f),
+    swayX(bend_factor * bend_factor, transform(grass_rot, repeat(0.8f, tuft))));
+
+  float trunk_height = 0.2f;
+  float leaf_height = 0.25f;
+  float leaf_angle = CPU_PI / 3.2f;
+  float sin_leaf = glm::sin(leaf_angle);
+  float cos_leaf = glm::cos(leaf_angle);
+  auto leaves = material(8, flat(0.01f, 0.05f, 0.01f), translate(0.0f, trunk_height + leaf_height, 0.0f,
+    cone(sin_leaf, cos_leaf, leaf_height) |
+    translate(0.0f, (leaf_height - 0.05f) / 3, 0.0f,
+      cone(sin_leaf, cos_leaf, leaf_height - 0.05f) |
+      translate(0.0f, (leaf_height - 0.05f - 0.05f) / 3, 0.0f, cone(sin_leaf, cos_leaf, leaf_height - 0.05f - 0.05f)))));
+  auto tree = leaves | material(7, flat(0.04f, 0.03f, 0.00f), verticalCapsule(trunk_height, 0.05f));
+  auto trees = below<SDF_Z>(-2.0f, translate(0.0f, -0.8f, 0.0f, scale(0.5f, repeat(0.8f, tree))));
+
+  auto clouds = above<SDF_Y>(0.6f, material(9, flat(0.30f, 0.30f, 0.30f),
+    translate(-time / 100, T(1.0f), time / 200, repeat(3.0f, round(0.02f, box(0.2f, 0.03f, 0.1f))))));
+
+  auto ground = material(10, flat(0.05f, 0.07f, 0.10f), planeY(-0.8f));
+  return magnemite | grass | trees | clouds | ground;
+}
+
+// Renders like MagnemiteScene, distance and colour from magnemiteSdf().
+struct MagnemiteSdfScene {
+  decltype(magnemiteSdf(0.0f)) shape;
+
+  MagnemiteSdfScene(const CpuFrame &frame) : shape(magnemiteSdf(frame.time)) {}
+
+  glm::vec2 scene(glm::vec3 point) const { return shape.eval(point); }
+  glm::vec3 sceneColor(float id, glm::vec3 point) const { return sdf::sceneColour(shape, id, point); }
+};
+
+#endif
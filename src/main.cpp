@@ -1,5 +1,8 @@
+#include <cfloat>
+#include <cstdlib>
 #include <memory>
 #include <stdexcept>
+#include <string>
 
 // Use glad headers.
 #define GLAD_GL_IMPLEMENTATION
@@ -17,6 +20,15 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include "ablation.hpp"
+#include "bench.hpp"
+#include "gpu_timer.hpp"
+#include "input_recording.hpp"
+#include "iteration_stats.hpp"
+#include "section_profiler.hpp"
+#include "shader_bench.hpp"
+#include "startup.hpp"
+#include "trace.hpp"
 #include "window.hpp"
 #include "shader_manager.hpp"
 
@@ -24,30 +36,124 @@
 #define MODE_3D_NAIVE 1
 #define MODE_3D_DUBOIS 2
 
+#define PASS_SCENE 0
+#define PASS_ITERATIONS 1
+#define PASS_SCREEN 2
+#define PASS_IMGUI 3
+
+#define QUALITY_LOW 0
+#define QUALITY_MEDIUM 1
+#define QUALITY_HIGH 2
+
+#define MAX_ITERATIONS 128  // Shader default, the medium preset.
+
+#define FRAME_UNIFORMS_BINDING 0
+
+// Embedded builds touch no files unless asked to with --shader-cache.
+#ifdef CSCI_4110U_EMBED_SHADERS
+#define SHADER_CACHE_DIR ""
+#else
+#define SHADER_CACHE_DIR "shader_cache"
+#endif
+
+static const char *scene_names[] = {"gundam", "magnemite", "magnemite-sdf"};
+static const char *mode_3d_names[] = {"none", "naive", "dubois"};
+static const char *gl_errors_names[] = {"off", "poll", "debug-output"};  // GL_ERRORS_*
+static const char *quality_names[] = {"low", "medium", "high"};
+
+// Ray march limits per QUALITY_*, medium keeps the shader defaults.
+static const ShaderDefines quality_defines[] = {
+  {{"MAX_ITERATIONS", "64"}, {"EPS", "0.002"}, {"FAR", "12.0"}},
+  {},
+  {{"MAX_ITERATIONS", "256"}, {"EPS", "0.0005"}, {"FAR", "30.0"}},
+};
+static const int quality_max_iterations[] = {64, MAX_ITERATIONS, 256};
+
+// The scene is specialised for the anaglyph mode and quality, and only
+// writes step counts when something reads them.
+static ShaderDefines sceneDefines(int quality, int mode_3d, bool iteration_output) {
+  ShaderDefines defines = quality_defines[quality];
+  defines["ANAGLYPH"] = std::to_string(mode_3d);
+  defines["ITERATION_OUTPUT"] = iteration_output ? "1" : "0";
+  return defines;
+}
+
+// The `Frame` uniform block of the scene shaders, std140 layout.
+struct FrameUniforms {
+  glm::vec3 mouse;
+  float time;
+  glm::vec3 resolution;
+  float time_delta;
+  int32_t anaglyph;
+  int32_t padding[3];  // Blocks are padded to a multiple of vec4.
+};
+static_assert(sizeof(FrameUniforms) == 48);
+
+struct ProgramOpts {
+  int scene_id = 0;
+  int mode_3d = MODE_3D_NONE;
+  int quality = QUALITY_MEDIUM;
+  int frame_limit = 0;          // Frames to draw before closing, 0 = unlimited.
+  int shader_bench_runs = 0;    // Time compiling every program this many times and close, 0 = off.
+  bool iteration_stats = false;
+  bool profile_sections = false;  // Requires a GL 4.3 context.
+  bool bench = false;
+  bool compare_gl_errors = false;  // Bench every GL error mode.
+  bool ablate = false;            // Benchmark the scene with each section removed.
+  float ablate_time = 10.0f;      // Fixed `itime` for the ablation.
+  std::string shader_cache = SHADER_CACHE_DIR;  // Program binary cache directory, empty for none.
+  std::string record{};           // Input recording written while running.
+  std::string replay{};           // Input recording played back instead of live input.
+  BenchOpts bench_opts{};
+};
+
 class Program : public Window {
   ImGuiIO *io;
   int scene_id;  // Scene to load and draw.
   int mode_3d;
+  int quality;
+  int stats_quality;  // Preset `iteration_stats` is sized for.
   bool draw_debug_menu;
+  bool wait_for_shaders;  // Measured or replayed runs never draw the placeholder.
+  int frame_limit;
+  int frame_count = 0;
+  bool collect_iteration_stats;
   const GLubyte *renderer_name;
 
-  glm::vec3 mouse_pos;
+  std::unique_ptr<Bench> bench;
+  std::unique_ptr<Ablation> ablation;
+  GLuint bench_query = 0;
+  int bench_config = -1;
+  std::unique_ptr<InputRecorder> recorder;
+  std::unique_ptr<InputReplay> replay;
+
+  glm::vec3 mouse_pos{0.0f};
   glm::vec3 resolution;     // Window resolution in pixels.
   double time_start;        // Used to calculate total playback time.
   double time_old;          // Used to calculate time delta.
 
   GLuint fbo = 0;
   GLuint image_texture = 0;
-  GLuint iterations_texture = 0;
+  GLuint iterations_texture = 0;          // Raw step counts (GL_R16UI).
+  GLuint iterations_fbo = 0;
+  GLuint iterations_colour_texture = 0;   // Step counts for display.
 
   ShaderManager shader_manager;
+  GpuTimer gpu_timer{{"Scene", "Iterations", "Screen", "ImGui"}};
+  IterationStats iteration_stats{MAX_ITERATIONS};
+  std::unique_ptr<SectionProfiler> section_profiler;
+  int heatmap_section = -1;  // Section drawn in place of the iterations, -1 for none.
   GLuint vbo_quad = 0;
   GLuint vbo_tex = 0;
   GLuint vao = 0;
+  GLuint frame_ubo = 0;  // FrameUniforms.
   GLenum draw_buffers[2] {
     GL_COLOR_ATTACHMENT0,
     GL_COLOR_ATTACHMENT1,
   };
+  GLfloat clear_colour[4] {0.0f, 0.0f, 0.0f, 0.0f};
+  GLfloat placeholder_colour[4] {0.4f, 0.75f, 1.0f, 1.0f};  // Sky, until the scene has compiled.
+  GLuint clear_iterations[4] {0, 0, 0, 0};
 
   //===== Section: Scene-Quad =====//
   float screen_quad[6 * 3] {
@@ -81,13 +187,15 @@ class Program : public Window {
 
 public:
   Program() : Window() {};
-  Program(WindowOpts opts) : Window(opts) {
+  Program(WindowOpts opts, ProgramOpts prog_opts) : Window(opts) {
     resolution = glm::vec3(opts.width, opts.height, 0.0f);
-    time_start = glfwGetTime();
-    time_old = glfwGetTime();
+    time_start = getTime();
+    time_old = getTime();
 
-    glfwSetWindowUserPointer(ptr, this);
-    glfwSetFramebufferSizeCallback(ptr, framebufferResized);
+    if (!headless) {
+      glfwSetWindowUserPointer(ptr, this);
+      glfwSetFramebufferSizeCallback(ptr, framebufferResized);
+    }
 
     renderer_name = glGetString(GL_RENDERER);
     glViewport(0, 0, opts.width, opts.height);
@@ -110,12 +218,20 @@ public:
     glBindBuffer(GL_ARRAY_BUFFER, vbo_tex);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, NULL);
 
+    glGenBuffers(1, &frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frame_ubo);
+    shader_manager.bindUniformBlock("Frame", FRAME_UNIFORMS_BINDING);
+
     glGenFramebuffers(1, &fbo);
+    glGenFramebuffers(1, &iterations_fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     setUpTextures();
 
+    shader_manager.useCache(prog_opts.shader_cache);
     //===== Section: Shaders =====//
-    shader_manager.compileAndWatch({
+    shader_manager.addAndWatch({
       .name = "gundam",
       .shaders = {
         Shader{.path = "shaders/util/vert.glsl",        .type = GL_VERTEX_SHADER},
@@ -124,7 +240,7 @@ public:
         Shader{.path = "shaders/gundam.glsl",           .type = GL_FRAGMENT_SHADER}
       }
     });
-    shader_manager.compileAndWatch({
+    shader_manager.addAndWatch({
       .name = "magnemite",
       .shaders = {
         Shader{.path = "shaders/util/vert.glsl",        .type = GL_VERTEX_SHADER},
@@ -133,6 +249,16 @@ public:
         Shader{.path = "shaders/magnemite.glsl",        .type = GL_FRAGMENT_SHADER}
       }
     });
+    // Generated by final-sdfgen from src/magnemite_sdf.hpp.
+    shader_manager.addAndWatch({
+      .name = "magnemite-sdf",
+      .shaders = {
+        Shader{.path = "shaders/util/vert.glsl",        .type = GL_VERTEX_SHADER},
+        Shader{.path = "shaders/util/sdf.glsl",         .type = GL_FRAGMENT_SHADER},
+        Shader{.path = "shaders/util/ray_marcher.glsl", .type = GL_FRAGMENT_SHADER},
+        Shader{.path = "shaders/magnemite-sdf.glsl",    .type = GL_FRAGMENT_SHADER}
+      }
+    });
     shader_manager.compileAndWatch({
       .name = "screen",
       .shaders = {
@@ -140,31 +266,85 @@ public:
         Shader{.path = "shaders/util/screen-frag.glsl", .type = GL_FRAGMENT_SHADER},
       }
     });
+    shader_manager.addAndWatch({
+      .name = "iterations",
+      .shaders = {
+        Shader{.path = "shaders/util/screen-vert.glsl",     .type = GL_VERTEX_SHADER},
+        Shader{.path = "shaders/util/iterations-frag.glsl", .type = GL_FRAGMENT_SHADER},
+      }
+    });
     //===== Section: Shaders =====//
 
+    if (prog_opts.profile_sections) {
+      if (SectionProfiler::supported()) {
+        section_profiler = std::make_unique<SectionProfiler>();
+        for (auto name : scene_names) {
+          shader_manager.compileAndWatch(section_profiler->profile(shader_manager.getProgram(name)));
+        }
+      } else {
+        spdlog::warn("Section profiling requires OpenGL 4.3, disabled.");
+      }
+    }
+
     // Debug Menu.
-    scene_id = 0;
-    mode_3d = MODE_3D_NONE;
+    scene_id = prog_opts.scene_id;
+    mode_3d = prog_opts.mode_3d;
+    quality = prog_opts.quality;
+    stats_quality = QUALITY_MEDIUM;
+    frame_limit = prog_opts.frame_limit;
+    collect_iteration_stats = prog_opts.iteration_stats;
     draw_debug_menu = false;
+    wait_for_shaders = prog_opts.bench || prog_opts.ablate || !prog_opts.replay.empty();
+
+    if (!prog_opts.record.empty()) recorder = std::make_unique<InputRecorder>(prog_opts.record);
+    if (!prog_opts.replay.empty()) replay = std::make_unique<InputReplay>(prog_opts.replay);
+
+    if (prog_opts.shader_bench_runs > 0) {
+      benchShaders(prog_opts.shader_bench_runs, prog_opts.bench_opts.output);
+      close();
+    } else if (prog_opts.ablate) {
+      ablation = std::make_unique<Ablation>(shader_manager, scene_names[scene_id], prog_opts.bench_opts, prog_opts.ablate_time);
+      glGenQueries(1, &bench_query);
+      if (ablation->done()) {
+        spdlog::error("Ablation: No variant of {} compiled, nothing to measure!", scene_names[scene_id]);
+        ablation.reset();
+        close();
+      }
+    } else if (prog_opts.bench) {
+      if (prog_opts.compare_gl_errors) {
+        prog_opts.bench_opts.configs.assign(std::begin(gl_errors_names), std::end(gl_errors_names));
+      }
+      bench = std::make_unique<Bench>(prog_opts.bench_opts);
+      glGenQueries(1, &bench_query);
+    }
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     io = &ImGui::GetIO();
     io->ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
-    ImGui_ImplGlfw_InitForOpenGL(ptr, true);
-    ImGui_ImplOpenGL3_Init();
+    if (!headless) {
+      ImGui_ImplGlfw_InitForOpenGL(ptr, true);
+      ImGui_ImplOpenGL3_Init();
+    }
+    Startup::mark("Program initialised");
   }
 
   ~Program() {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    glDeleteQueries(1, &bench_query);
+    glDeleteBuffers(1, &frame_ubo);
+    if (!headless) {
+      ImGui_ImplOpenGL3_Shutdown();
+      ImGui_ImplGlfw_Shutdown();
+    }
     ImGui::DestroyContext();
   }
 
   void setUpTextures() {
+    TraceScope scope{"setUpTextures"};
     //===== Section: setUpTextures =====//
     // Safe since 0's and non-existant textures are silently ignored.
     glDeleteTextures(1, &image_texture);
     glDeleteTextures(1, &iterations_texture);
+    glDeleteTextures(1, &iterations_colour_texture);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
     glGenTextures(1, &image_texture);
@@ -174,11 +354,12 @@ public:
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    // Integer texture: holds the raw step count, can not be filtered.
     glGenTextures(1, &iterations_texture);
     glBindTexture(GL_TEXTURE_2D, iterations_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, resolution.x, resolution.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, resolution.x, resolution.y, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image_texture, 0);
@@ -187,6 +368,21 @@ public:
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
       spdlog::critical("glCheckFramebufferStatus: Framebuffer is incomplete!");
     }
+
+    glGenTextures(1, &iterations_colour_texture);
+    glBindTexture(GL_TEXTURE_2D, iterations_colour_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, resolution.x, resolution.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, iterations_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, iterations_colour_texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      spdlog::critical("glCheckFramebufferStatus: Iterations framebuffer is incomplete!");
+    }
+
+    iteration_stats.resize(resolution.x, resolution.y);
   }
 
   void handleInput(int key, int action) override {
@@ -196,57 +392,145 @@ public:
   }
 
   void draw() override {
-    shader_manager.recompilePending();
+    if (bench && bench->configCount() > 0 && bench->config() != bench_config) {
+      // Config index is the GL_ERRORS_* mode.
+      bench_config = bench->config();
+      setGLErrors(bench_config);
+    }
+    double frame_start = getTime();
+    if (bench || ablation) glBeginQuery(GL_TIME_ELAPSED, bench_query);
 
-    double x, y;
-    int mouse_left_down = glfwGetMouseButton(ptr, GLFW_MOUSE_BUTTON_LEFT);
-    glfwGetCursorPos(ptr, &x, &y);
-    y = resolution.y - y;  // Invert y-axis to make positive up.
-    mouse_pos.x = x;
-    mouse_pos.y = y;
-    mouse_pos.z = mouse_left_down == GLFW_PRESS ? 1 : 0;
+    {
+      TraceScope scope{"recompilePending"};
+      shader_manager.recompilePending();
+    }
 
-    auto time_now = glfwGetTime();
+    if (!headless) {
+      double x, y;
+      int mouse_left_down = glfwGetMouseButton(ptr, GLFW_MOUSE_BUTTON_LEFT);
+      glfwGetCursorPos(ptr, &x, &y);
+      y = resolution.y - y;  // Invert y-axis to make positive up.
+      mouse_pos.x = x;
+      mouse_pos.y = y;
+      mouse_pos.z = mouse_left_down == GLFW_PRESS ? 1 : 0;
+    }
+
+    auto time_now = getTime();
     float time = (float)(time_now - time_start);
     float time_delta = (float)(time_now - time_old);
     time_old = time_now;
+    if (bench) {
+      // Fixed timestep so every run renders the same animation phases.
+      time = bench->time();
+      time_delta = bench->timeStep();
+    }
+    if (ablation) {
+      // Same frame every time, only the shader changes.
+      time = ablation->time();
+      time_delta = 0.0f;
+      mouse_pos = glm::vec3(0.0f);
+    }
+    if (replay && !replay->done()) {
+      auto &input = replay->next();
+      mouse_pos = glm::vec3(input.mouse[0], input.mouse[1], input.mouse[2]);
+      time = input.time;
+      time_delta = input.time_delta;
+      if (input.anaglyph >= 0 && input.anaglyph < 3) mode_3d = input.anaglyph;
+      if (input.scene_id >= 0 && input.scene_id < 3) scene_id = input.scene_id;
+    }
+    if (recorder) {
+      recorder->record({
+        .mouse = {mouse_pos.x, mouse_pos.y, mouse_pos.z},
+        .time = time,
+        .time_delta = time_delta,
+        .anaglyph = mode_3d,
+        .scene_id = scene_id,
+      });
+    }
+
+    bool iteration_output = draw_debug_menu || collect_iteration_stats || ablation || section_profiler;
+    ShaderDefines scene_defines = sceneDefines(quality, mode_3d, iteration_output);
+    // Ablation and profiling programs use the shader defaults.
+    int shader_quality = ablation || section_profiler ? QUALITY_MEDIUM : quality;
+    if (stats_quality != shader_quality) {
+      iteration_stats.setMaxIterations(quality_max_iterations[shader_quality]);
+      stats_quality = shader_quality;
+    }
 
     GLuint scene = 0;
-    switch (scene_id) {
-      case 0:
-        scene = shader_manager.get("gundam");
-        break;
-      case 1:
-        scene = shader_manager.get("magnemite");
-        break;
-      default:
-        scene = shader_manager.get("gundam");
+    if (section_profiler) {
+      scene = shader_manager.get(std::string(scene_names[scene_id]) + "-profile");
+      section_profiler->beginFrame(resolution.x * resolution.y);
+    } else if (ablation) {
+      scene = shader_manager.get(ablation->program());
+    } else {
+      switch (scene_id) {
+        case 0:
+          scene = shader_manager.get("gundam", scene_defines, wait_for_shaders);
+          break;
+        case 1:
+          scene = shader_manager.get("magnemite", scene_defines, wait_for_shaders);
+          break;
+        case 2:
+          scene = shader_manager.get("magnemite-sdf", scene_defines, wait_for_shaders);
+          break;
+        default:
+          scene = shader_manager.get("gundam", scene_defines, wait_for_shaders);
+      }
     }
+    if (scene) Startup::ready();
 
     // Render scene to FBO
+    gpu_timer.beginFrame();
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glBindTexture(GL_TEXTURE_2D, 0);
     glUseProgram(scene);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    GLuint imouse = glGetUniformLocation(scene, "imouse");
-    GLuint iresolution = glGetUniformLocation(scene, "iresolution");
-    GLuint itime = glGetUniformLocation(scene, "itime");
-    GLuint itime_delta = glGetUniformLocation(scene, "itime_delta");
-    GLuint ianaglyph = glGetUniformLocation(scene, "ianaglyph");
-    glUniform3fv(imouse, 1, glm::value_ptr(mouse_pos));
-    glUniform3fv(iresolution, 1, glm::value_ptr(resolution));
-    glUniform1f(itime, time);
-    glUniform1f(itime_delta, time_delta);
-    glUniform1i(ianaglyph, mode_3d);
+    {
+      TraceScope scope{"Uniforms"};
+      FrameUniforms frame{
+        .mouse = mouse_pos,
+        .time = time,
+        .resolution = resolution,
+        .time_delta = time_delta,
+        .anaglyph = mode_3d,
+        .padding = {},
+      };
+      // Still bound from the constructor, nothing else uses GL_UNIFORM_BUFFER.
+      glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+      if (section_profiler) {
+        auto &profile = shader_manager.getProgram(std::string(scene_names[scene_id]) + "-profile");
+        glUniform1i(profile.uniform("iprofile_section"), heatmap_section);
+        glUniform1ui(profile.uniform("iprofile_scale"), section_profiler->heatmapScale(heatmap_section));
+      }
+    }
 
     glBindVertexArray(vao);
-    glDrawBuffers(2, draw_buffers);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDrawBuffers(iteration_output ? 2 : 1, draw_buffers);
+    // glClear is undefined for integer attachments, clear each one instead.
+    glClearBufferfv(GL_COLOR, 0, scene ? clear_colour : placeholder_colour);
+    if (iteration_output) glClearBufferuiv(GL_COLOR, 1, clear_iterations);
+    if (scene) glDrawArrays(GL_TRIANGLES, 0, 6);
+    gpu_timer.endPass(PASS_SCENE);
+    if (section_profiler) section_profiler->endFrame();
+
+    if (collect_iteration_stats && scene) {
+      iteration_stats.readback(fbo, GL_COLOR_ATTACHMENT1);
+    }
+
+    // Colour the step counts for the debug menu.
+    GLuint iterations = draw_debug_menu ? shader_manager.get("iterations", quality_defines[shader_quality]) : 0;
+    if (iterations) {
+      glBindFramebuffer(GL_FRAMEBUFFER, iterations_fbo);
+      glUseProgram(iterations);
+      glBindTexture(GL_TEXTURE_2D, iterations_texture);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    gpu_timer.endPass(PASS_ITERATIONS);
 
     // Render FBO to screen.
     auto screen = shader_manager.get("screen");
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, default_fbo);
     glUseProgram(screen);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -262,16 +546,50 @@ public:
         ImGui::Text("Device: %s", renderer_name);
         ImGui::Text("Resolution: %.0fx%.0f", resolution.x, resolution.y);
         ImGui::Text("Fps: %.0f (%.3f)", io->Framerate, 1000.0f / io->Framerate);
-        ImGui::Image((ImTextureID)(intptr_t)iterations_texture, image_size, ImVec2(0, 1), ImVec2(1, 0));
+        ImGui::Image((ImTextureID)(intptr_t)iterations_colour_texture, image_size, ImVec2(0, 1), ImVec2(1, 0));
+
+        ImGui::SeparatorText("Iterations");
+        ImGui::Checkbox("Collect statistics", &collect_iteration_stats);
+        if (collect_iteration_stats) {
+          auto &stats = iteration_stats.latest();
+          ImGui::Text("Mean: %.2f  Max: %d  At limit: %.2f%%", stats.mean, stats.max, stats.max_fraction * 100.0);
+          ImGui::PlotHistogram("Steps", stats.histogram.data(), stats.histogram.size(),
+                               0, nullptr, 0.0f, FLT_MAX, ImVec2(image_size.x, 40.0f));
+        }
+
+        ImGui::SeparatorText("GPU Passes");
+        if (ImGui::BeginTable("gpu_passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+          ImGui::TableSetupColumn("Pass");
+          ImGui::TableSetupColumn("Last (ms)");
+          ImGui::TableSetupColumn("Avg (ms)");
+          ImGui::TableHeadersRow();
+          for (int pass = 0; pass < gpu_timer.passCount(); pass++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(gpu_timer.passName(pass).c_str());
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", gpu_timer.latest(pass));
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", gpu_timer.average(pass));
+          }
+          ImGui::EndTable();
+        }
+        ImGui::PlotLines("Scene", gpu_timer.historyData(PASS_SCENE), gpu_timer.historySize(),
+                         gpu_timer.historyOffset(), nullptr, 0.0f, FLT_MAX, ImVec2(image_size.x, 40.0f));
+
+        if (section_profiler) drawSectionTable();
 
         ImGui::SeparatorText("Scene");
         ImGui::RadioButton("Gundam", &scene_id, 0); ImGui::SameLine();
-        ImGui::RadioButton("Magnemite", &scene_id, 1);
+        ImGui::RadioButton("Magnemite", &scene_id, 1); ImGui::SameLine();
+        ImGui::RadioButton("Magnemite (SDF)", &scene_id, 2);
 
         ImGui::SeparatorText("Anaglyph 3D");
         ImGui::RadioButton("None", &mode_3d, MODE_3D_NONE); ImGui::SameLine();
         ImGui::RadioButton("Naive", &mode_3d, MODE_3D_NAIVE); ImGui::SameLine();
         ImGui::RadioButton("Dubois Revised", &mode_3d, MODE_3D_DUBOIS);
+
+        ImGui::SeparatorText("Quality");
+        ImGui::RadioButton("Low", &quality, QUALITY_LOW); ImGui::SameLine();
+        ImGui::RadioButton("Medium", &quality, QUALITY_MEDIUM); ImGui::SameLine();
+        ImGui::RadioButton("High", &quality, QUALITY_HIGH);
       }
       ImGui::End();
     }
@@ -279,15 +597,167 @@ public:
     glBindTexture(GL_TEXTURE_2D, image_texture);
     glBindVertexArray(vao);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    gpu_timer.endPass(PASS_SCREEN);
 
     if (draw_debug_menu) {
       ImGui::Render();
       ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
+    gpu_timer.endPass(PASS_IMGUI);
+    gpu_timer.endFrame();
+
+    if (bench) endBenchFrame(frame_start);
+    if (ablation) endAblationFrame(frame_start);
+
+    frame_count++;
+    if (frame_limit > 0 && frame_count >= frame_limit) close();
+    if (replay && replay->done() && !bench) close();
+  }
+
+  void drawSectionTable() {
+    ImGui::SeparatorText("Sections");
+    ImGui::RadioButton("Heatmap off", &heatmap_section, -1);
+    if (!ImGui::BeginTable("sections", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) return;
+
+    bool clock = section_profiler->hasClock();
+    double total = 0.0;
+    for (auto &cost : section_profiler->latest()) total += clock ? cost.cycles : cost.evaluations;
+
+    ImGui::TableSetupColumn("Section (heatmap)");
+    ImGui::TableSetupColumn("Evals/px");
+    ImGui::TableSetupColumn(clock ? "Cycles/px" : "Share");
+    ImGui::TableHeadersRow();
+    auto &costs = section_profiler->latest();
+    for (int i = 0; i < (int)costs.size(); i++) {
+      if (costs[i].evaluations == 0.0) continue;  // Section not in this scene.
+
+      double cost = clock ? costs[i].cycles : costs[i].evaluations;
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (ImGui::Selectable(costs[i].name.c_str(), heatmap_section == i)) heatmap_section = i;
+      ImGui::TableNextColumn(); ImGui::Text("%.2f", costs[i].evaluations);
+      ImGui::TableNextColumn();
+      if (clock) {
+        ImGui::Text("%.0f (%.1f%%)", cost, total > 0.0 ? 100.0 * cost / total : 0.0);
+      } else {
+        ImGui::Text("%.1f%%", total > 0.0 ? 100.0 * cost / total : 0.0);
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  void endBenchFrame(double frame_start) {
+    // Waiting on the GPU serialises frames, but makes each measurement cover
+    // exactly one frame's work.
+    GLuint64 gpu_ns = 0;
+    glEndQuery(GL_TIME_ELAPSED);
+    glFinish();
+    glGetQueryObjectui64v(bench_query, GL_QUERY_RESULT, &gpu_ns);
+
+    double frame_ms = (getTime() - frame_start) * 1000.0;
+    if (collect_iteration_stats && iteration_stats.poll()) {
+      auto &stats = iteration_stats.latest();
+      bench->addIterationStats(stats.mean, stats.max, stats.max_fraction);
+    }
+    bench->addFrame(frame_ms, gpu_ns / 1.0e6);
+
+    if (bench->done() || (replay && replay->done())) {
+      bench->writeReport({
+        .scene = scene_names[scene_id],
+        .width = (int)resolution.x,
+        .height = (int)resolution.y,
+        .anaglyph = mode_3d_names[mode_3d],
+        .quality = quality_names[quality],
+        .renderer = (const char *)renderer_name,
+        .gl_errors = bench_config < 0 ? gl_errors_names[gl_errors] : "compare",
+      });
+      close();
+    }
+  }
+
+  void endAblationFrame(double frame_start) {
+    GLuint64 gpu_ns = 0;
+    glEndQuery(GL_TIME_ELAPSED);
+    glFinish();
+    glGetQueryObjectui64v(bench_query, GL_QUERY_RESULT, &gpu_ns);
+
+    ablation->addFrame((getTime() - frame_start) * 1000.0, gpu_ns / 1.0e6);
+    if (ablation->done()) {
+      ablation->writeReport({
+        .scene = scene_names[scene_id],
+        .width = (int)resolution.x,
+        .height = (int)resolution.y,
+        .anaglyph = mode_3d_names[mode_3d],
+        .quality = quality_names[QUALITY_MEDIUM],  // Variants use the shader defaults.
+        .renderer = (const char *)renderer_name,
+        .gl_errors = gl_errors_names[gl_errors],
+      });
+      close();
+    }
+  }
+
+  // Every program the app can draw with, in every permutation.
+  void benchShaders(int runs, const std::string &output) {
+    ShaderBench shader_bench{runs, output};
+    for (auto name : scene_names) {
+      for (int preset = QUALITY_LOW; preset <= QUALITY_HIGH; preset++) {
+        for (int mode = MODE_3D_NONE; mode <= MODE_3D_DUBOIS; mode++) {
+          shader_bench.measure(shader_manager, name, sceneDefines(preset, mode, false));
+          shader_bench.measure(shader_manager, name, sceneDefines(preset, mode, true));
+        }
+      }
+    }
+    for (auto &defines : quality_defines) shader_bench.measure(shader_manager, "iterations", defines);
+    shader_bench.measure(shader_manager, "screen");
+    shader_bench.writeReport((const char *)renderer_name);
   }
 };
 
-int main() {
+static int findName(const char *const *names, int count, const std::string &name) {
+  for (int i = 0; i < count; i++) {
+    if (name == names[i]) return i;
+  }
+  return -1;
+}
+
+// Before the context is created, drivers read it then.
+static void setEnv(const char *name, const char *value) {
+#ifdef _WIN32
+  _putenv_s(name, value);
+#else
+  setenv(name, value, 1);
+#endif
+}
+
+static void printUsage() {
+  spdlog::info("Usage: final [options]");
+  spdlog::info("  --headless             Render offscreen (requires EGL)");
+  spdlog::info("  --frames N             Close after N frames");
+  spdlog::info("  --scene NAME           gundam | magnemite | magnemite-sdf");
+  spdlog::info("  --size WxH             Resolution, default 1152x720");
+  spdlog::info("  --anaglyph MODE        none | naive | dubois");
+  spdlog::info("  --quality PRESET       low | medium | high ray march limits");
+  spdlog::info("  --iteration-stats      Read back ray march step counts (mean/max/histogram)");
+  spdlog::info("  --profile-sections     Per-section shader costs (GL 4.3 context)");
+  spdlog::info("  --bench                Benchmark: fixed timestep, no vsync, JSON report");
+  spdlog::info("  --warmup N             Bench: unmeasured warmup frames (60)");
+  spdlog::info("  --bench-frames N       Bench: measured frames (600)");
+  spdlog::info("  --time-step S          Bench: itime step per frame in seconds (1/60)");
+  spdlog::info("  --capture-gl PATH      Record every GL call to PATH, see final-analyse");
+  spdlog::info("  --capture-frames N     Capture: frames to record (10)");
+  spdlog::info("  --trace PATH           Write a Chrome trace (Perfetto) of CPU scopes and GPU passes");
+  spdlog::info("  --shader-cache DIR     Program binary cache ({})", *SHADER_CACHE_DIR ? SHADER_CACHE_DIR : "none");
+  spdlog::info("  --no-shader-cache      Always compile shaders from source");
+  spdlog::info("  --record PATH          Write per-frame input (mouse, time, anaglyph, scene) to PATH");
+  spdlog::info("  --replay PATH          Play back recorded input, closes at the end");
+  spdlog::info("  --ablate               Benchmark the scene once per removed section");
+  spdlog::info("  --time S               Ablate: fixed itime in seconds (10)");
+  spdlog::info("  --shader-bench N       Compile and link every program permutation N times, JSON report");
+  spdlog::info("  --gl-errors MODE        poll | debug-output | off, or compare with --bench");
+  spdlog::info("  --output PATH          Bench/ablate/shader bench: report path (bench.json)");
+}
+
+int main(int argc, char **argv) {
   auto console_target = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
   spdlog::sinks_init_list targets = {console_target};
   auto logger = std::make_shared<spdlog::logger>("logger", targets);
@@ -298,11 +768,109 @@ int main() {
   spdlog::info("//-------------------------//");
   spdlog::info("//        CSCI4110U        //");
   spdlog::info("//-------------------------//");
+  Startup::mark("main");
+
+  WindowOpts window_opts{.width = 1152, .height = 720, .title = "RayMarcher - SDF"};
+  ProgramOpts prog_opts{};
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      bool has_value = i + 1 < argc;
+      if (arg == "--help") {
+        printUsage();
+        return 0;
+      } else if (arg == "--headless") {
+        window_opts.headless = true;
+      } else if (arg == "--iteration-stats") {
+        prog_opts.iteration_stats = true;
+      } else if (arg == "--profile-sections") {
+        prog_opts.profile_sections = true;
+        window_opts.glMajor = 4;
+        window_opts.glMinor = 3;
+      } else if (arg == "--bench") {
+        prog_opts.bench = true;
+        window_opts.vsync = false;
+      } else if (arg == "--gl-errors" && has_value) {
+        std::string mode = argv[++i];
+        if (mode == "compare") {
+          prog_opts.compare_gl_errors = true;
+          // debug-output is only measured fairly on a debug context.
+          window_opts.debug_context = true;
+          window_opts.glMajor = 4;
+          window_opts.glMinor = 3;
+          continue;
+        }
+        window_opts.gl_errors = findName(gl_errors_names, 3, mode);
+        if (window_opts.gl_errors < 0) throw std::invalid_argument(arg);
+        if (window_opts.gl_errors == GL_ERRORS_DEBUG_OUTPUT) {
+          window_opts.glMajor = 4;
+          window_opts.glMinor = 3;
+        }
+      } else if (arg == "--capture-gl" && has_value) {
+        window_opts.gl_capture = argv[++i];
+      } else if (arg == "--capture-frames" && has_value) {
+        window_opts.gl_capture_frames = std::stoi(argv[++i]);
+      } else if (arg == "--trace" && has_value) {
+        Trace::start(argv[++i]);
+      } else if (arg == "--shader-cache" && has_value) {
+        prog_opts.shader_cache = argv[++i];
+      } else if (arg == "--no-shader-cache") {
+        prog_opts.shader_cache = "";
+      } else if (arg == "--record" && has_value) {
+        prog_opts.record = argv[++i];
+      } else if (arg == "--replay" && has_value) {
+        prog_opts.replay = argv[++i];
+      } else if (arg == "--ablate") {
+        prog_opts.ablate = true;
+        window_opts.vsync = false;
+      } else if (arg == "--shader-bench" && has_value) {
+        prog_opts.shader_bench_runs = std::stoi(argv[++i]);
+        // Driver disk caches would turn every run after the first into a load.
+        setEnv("MESA_SHADER_CACHE_DISABLE", "true");
+        setEnv("__GL_SHADER_DISK_CACHE", "0");
+      } else if (arg == "--time" && has_value) {
+        prog_opts.ablate_time = std::stof(argv[++i]);
+      } else if (arg == "--frames" && has_value) {
+        prog_opts.frame_limit = std::stoi(argv[++i]);
+      } else if (arg == "--scene" && has_value) {
+        prog_opts.scene_id = findName(scene_names, 3, argv[++i]);
+        if (prog_opts.scene_id < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--anaglyph" && has_value) {
+        prog_opts.mode_3d = findName(mode_3d_names, 3, argv[++i]);
+        if (prog_opts.mode_3d < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--quality" && has_value) {
+        prog_opts.quality = findName(quality_names, 3, argv[++i]);
+        if (prog_opts.quality < 0) throw std::invalid_argument(arg);
+      } else if (arg == "--size" && has_value) {
+        std::string size = argv[++i];
+        auto x = size.find('x');
+        if (x == std::string::npos) throw std::invalid_argument(arg);
+        window_opts.width = std::stoi(size.substr(0, x));
+        window_opts.height = std::stoi(size.substr(x + 1));
+      } else if (arg == "--warmup" && has_value) {
+        prog_opts.bench_opts.warmup_frames = std::stoi(argv[++i]);
+      } else if (arg == "--bench-frames" && has_value) {
+        prog_opts.bench_opts.frames = std::stoi(argv[++i]);
+      } else if (arg == "--time-step" && has_value) {
+        prog_opts.bench_opts.time_step = std::stof(argv[++i]);
+      } else if (arg == "--output" && has_value) {
+        prog_opts.bench_opts.output = argv[++i];
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  } catch (std::logic_error &err) {
+    spdlog::error("Invalid argument: {}", err.what());
+    printUsage();
+    return -1;
+  }
 
   Program *window;
   try {
-    window = new Program({.width = 1152, .height = 720, .title = "RayMarcher - SDF"});
+    window = new Program(window_opts, prog_opts);
     window->run();
+    delete window;
+    Trace::stop();
   } catch(std::runtime_error &err) {
     return -1;
   }
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "program_cache.hpp"
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+void ProgramCache::open(const std::string &cache_dir) {
+  enabled = false;
+  if (cache_dir.empty()) return;
+
+  GLint formats = 0;
+  if (GLAD_GL_VERSION_4_1) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats == 0) {
+    spdlog::info("Program cache: Driver has no program binary formats, disabled.");
+    return;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(cache_dir, error);
+  if (error) {
+    spdlog::warn("Program cache: Could not create {} ({}), disabled.", cache_dir, error.message());
+    return;
+  }
+
+  dir = cache_dir;
+  driver = std::string((const char *)glGetString(GL_VENDOR)) + "\n"
+         + (const char *)glGetString(GL_RENDERER) + "\n"
+         + (const char *)glGetString(GL_VERSION);
+  enabled = true;
+}
+
+std::string ProgramCache::path(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+  return dir + "/" + name;
+}
+
+// FNV-1a, stable between runs and platforms unlike std::hash.
+uint64_t ProgramCache::add(uint64_t key, const std::string &data) {
+  auto length = std::to_string(data.size()) + ":";  // Keeps "ab" + "c" apart from "a" + "bc".
+  for (char c : length + data) {
+    key ^= (unsigned char)c;
+    key *= FNV_PRIME;
+  }
+  return key;
+}
+
+uint64_t ProgramCache::begin() const {
+  return add(FNV_OFFSET, driver);
+}
+
+GLuint ProgramCache::load(uint64_t key) const {
+  if (!enabled) return 0;
+
+  std::ifstream file{path(key), std::ios::binary};
+  GLenum format;
+  if (!file.read((char *)&format, sizeof(format))) return 0;
+  std::vector<char> binary{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, format, binary.data(), binary.size());
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status == GL_FALSE) {
+    spdlog::warn("Program cache: Driver rejected {}, rebuilding.", path(key));
+    glDeleteProgram(program);
+    file.close();
+    std::filesystem::remove(path(key));
+    return 0;
+  }
+  return program;
+}
+
+void ProgramCache::store(uint64_t key, GLuint program) const {
+  if (!enabled) return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return;
+
+  std::vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  // Written to a temporary first so that a crash never leaves half a binary.
+  auto target = path(key);
+  auto temporary = target + ".tmp";
+  {
+    std::ofstream file{temporary, std::ios::binary};
+    file.write((const char *)&format, sizeof(format));
+    file.write(binary.data(), binary.size());
+    if (!file) {
+      spdlog::warn("Program cache: Could not write {}", temporary);
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, target, error);
+}
@@ -0,0 +1,36 @@
+#ifndef CSCI_4110U_PROGRAM_CACHE_H
+#define CSCI_4110U_PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include <GL/gl.h>
+
+/* On-disk cache of linked program binaries (glGetProgramBinary).
+
+   Entries are keyed by a hash of the final source of every shader in the
+   program (after transforms, so defines and instrumentation are included),
+   their stages and the driver's vendor, renderer and version strings. A
+   driver update therefore misses the cache instead of loading a stale
+   binary, and a binary the driver still rejects is deleted and rebuilt.
+   Requires GL 4.1 and at least one binary format, otherwise disabled.
+*/
+class ProgramCache {
+  std::string dir{};
+  std::string driver{};
+  bool enabled = false;
+
+  std::string path(uint64_t key) const;
+
+  public:
+    void open(const std::string &dir);  // Empty disables the cache.
+    bool active() const { return enabled; }
+
+    uint64_t begin() const;
+    static uint64_t add(uint64_t key, const std::string &data);
+
+    GLuint load(uint64_t key) const;  // 0 on a miss.
+    void store(uint64_t key, GLuint program) const;
+};
+
+#endif
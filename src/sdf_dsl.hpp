@@ -0,0 +1,470 @@
+#ifndef CSCI_4110U_SDF_DSL_H
+#define CSCI_4110U_SDF_DSL_H
+
+#include <concepts>
+#include <limits>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include "cpu_scenes.hpp"
+#include "cpu_sdf.hpp"
+
+/* SDF scenes as C++ values. Every primitive, operation and combinator is a
+   small struct holding its parameters and its children by value, so a scene
+   is one object whose type is the whole tree:
+
+     auto screw = sdf::twistY(100.0f, sdf::round(0.002f, sdf::box(0.02f, 0.045f, 0.02f)));
+     auto scene = sdf::material(5, sdf::flat(0.1f, 0.1f, 0.1f), screw) | sdf::planeY(-0.8f);
+
+   eval(point) returns vec2(distance, material) like the scenes' scene(). It
+   is inline all the way down, the compiler sees the whole tree with no
+   virtual calls or allocations per sample. The arithmetic is that of
+   cpu_sdf.hpp and the hand written scenes, in the same order.
+
+   T is the type of the parameters: float to evaluate, GlslFloat to write
+   the scene out as GLSL (sdf_glsl.hpp).
+*/
+
+namespace sdf {
+
+#define SDF_X 0
+#define SDF_Y 1
+#define SDF_Z 2
+
+template<typename T>
+struct Vec2 {
+  T x, y;
+};
+
+template<typename T>
+struct Vec3 {
+  T x, y, z;
+};
+
+// point' = rows * point + offset, each component a dot product in x, y, z
+// order like glm.
+template<typename T>
+struct Affine {
+  Vec3<T> rows[3];
+  Vec3<T> offset;
+};
+
+// Distance and material, like vec2 res in the shaders.
+template<typename N>
+concept Sdf3 = requires(const N &node, glm::vec3 point) {
+  { node.eval(point) } -> std::same_as<glm::vec2>;
+};
+
+// A shape in the xy plane, see extrude().
+template<typename N>
+concept Sdf2 = requires(const N &node, glm::vec2 point) {
+  { node.eval2(point) } -> std::same_as<float>;
+};
+
+// Moves the point before `child` sees it.
+template<typename N>
+concept DomainOp = requires(const N &node, glm::vec3 point) {
+  { node.apply(point) } -> std::same_as<glm::vec3>;
+  node.child;
+};
+
+inline glm::vec2 vec(Vec2<float> v) { return glm::vec2(v.x, v.y); }
+inline glm::vec3 vec(Vec3<float> v) { return glm::vec3(v.x, v.y, v.z); }
+
+// Maths for working out parameters, with GlslFloat overloads in
+// sdf_glsl.hpp. No branches on T, a GlslFloat can not be compared.
+inline float sin(float x) { return glm::sin(x); }
+inline float cos(float x) { return glm::cos(x); }
+inline float floor(float x) { return glm::floor(x); }
+inline float sign(float x) { return glm::sign(x); }
+inline float max(float x, float y) { return glm::max(x, y); }
+inline float mod(float x, float y) { return x - y * glm::floor(x / y); }  // GLSL's mod.
+
+//===== Section: Primitives =====//
+template<typename T>
+struct Sphere {
+  T radius;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(sdfSphere(point, radius), CPU_UNKNOWN_MAT); }
+};
+
+template<typename T>
+struct Box {
+  Vec3<T> half_size;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(sdfBox(point, vec(half_size)), CPU_UNKNOWN_MAT); }
+};
+
+template<typename T>
+struct CutSphere {
+  T radius;
+  T height;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(sdfCutSphere(point, radius, height), CPU_UNKNOWN_MAT); }
+};
+
+template<typename T>
+struct VerticalCapsule {
+  T height;
+  T radius;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(sdfVerticalCapsule(point, height, radius), CPU_UNKNOWN_MAT); }
+};
+
+template<typename T>
+struct Cone {
+  Vec2<T> sc_angle;  // sin, cos of the half angle.
+  T height;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(sdfCone(point, vec(sc_angle), height), CPU_UNKNOWN_MAT); }
+};
+
+// The ground, everything below y = height is inside.
+template<typename T>
+struct PlaneY {
+  T height;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(point.y - height, CPU_UNKNOWN_MAT); }
+};
+
+template<typename T>
+struct Vesica2D {
+  T radius;
+  T offset;
+  float eval2(glm::vec2 point) const { return sdfVesica2D(point, radius, offset); }
+};
+
+template<typename T>
+struct Horseshoe2D {
+  Vec2<T> curve;  // cos, sin of the opening angle.
+  T inner_radius;
+  Vec2<T> arm;    // Length, thickness.
+  float eval2(glm::vec2 point) const { return sdfHorseshoe2D(point, vec(curve), inner_radius, vec(arm)); }
+};
+//===== Section: Primitives =====//
+
+//===== Section: Domain =====//
+template<typename T, typename N>
+struct Translate {
+  Vec3<T> offset;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const { return point - vec(offset); }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+
+template<typename T, typename N>
+struct Transform {
+  Affine<T> affine;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const {
+    const auto &r = affine.rows;
+    return glm::vec3(
+      r[0].x * point.x + r[0].y * point.y + r[0].z * point.z + affine.offset.x,
+      r[1].x * point.x + r[1].y * point.y + r[1].z * point.z + affine.offset.y,
+      r[2].x * point.x + r[2].y * point.y + r[2].z * point.z + affine.offset.z);
+  }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+
+template<typename T, typename N>
+struct TwistY {
+  T amount;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const { return sdfOpTwistY(point, amount); }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+
+// Infinite copies in the xz plane.
+template<typename T, typename N>
+struct Repeat {
+  Vec2<T> scale;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const {
+    glm::vec2 xz = sdfOpRepeat2D(glm::vec2(point.x, point.z), vec(scale));
+    return glm::vec3(xz.x, point.y, xz.y);
+  }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+
+// 2 * limit + 1 copies along x and z.
+template<typename T, typename N>
+struct RepeatClamped {
+  Vec2<T> scale;
+  Vec2<T> limit;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const {
+    glm::vec2 xz = sdfOpRepeat2DClamped(glm::vec2(point.x, point.z), vec(scale), vec(limit));
+    return glm::vec3(xz.x, point.y, xz.y);
+  }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+
+// abs() of one axis. With a flip axis, that one is negated on the positive
+// side too, so the mirrored copy is turned rather than reflected.
+template<int Axis, int Flip, typename N>  // Flip -1 for none.
+struct Mirror {
+  N child;
+  glm::vec3 apply(glm::vec3 point) const {
+    bool positive = point[Axis] > 0;
+    point[Axis] = glm::abs(point[Axis]);
+    if constexpr (Flip >= 0) {
+      if (positive) point[Flip] = -point[Flip];
+    }
+    return point;
+  }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+
+// Uniform scale: the child at point * factor, its distance divided back.
+template<typename T, typename N>
+struct Scale {
+  T factor;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const { return point * factor; }
+  glm::vec2 eval(glm::vec3 point) const {
+    glm::vec2 res = child.eval(apply(point));
+    res.x /= factor;
+    return res;
+  }
+};
+
+// Leans x with the cube of the height within each unit, grass in the wind.
+template<typename T, typename N>
+struct SwayX {
+  T strength;
+  N child;
+  glm::vec3 apply(glm::vec3 point) const {
+    float fy = glm::fract(point.y);
+    point.x -= -fy * fy * fy * strength;
+    return point;
+  }
+  glm::vec2 eval(glm::vec3 point) const { return child.eval(apply(point)); }
+};
+//===== Section: Domain =====//
+
+//===== Section: Distance =====//
+// A 2D child becomes a slab of half thickness `amount` about z = 0.
+template<typename T, Sdf2 N>
+struct Extrude {
+  T amount;
+  N child;
+  glm::vec2 eval(glm::vec3 point) const {
+    return glm::vec2(sdfOpExtrude(point, child.eval2(glm::vec2(point.x, point.y)), amount), CPU_UNKNOWN_MAT);
+  }
+};
+
+// Rounds the edges by pushing the surface out by `radius`.
+template<typename T, typename N>
+struct Round {
+  T radius;
+  N child;
+  glm::vec2 eval(glm::vec3 point) const requires Sdf3<N> {
+    glm::vec2 res = child.eval(point);
+    res.x -= radius;
+    return res;
+  }
+  float eval2(glm::vec2 point) const requires Sdf2<N> { return child.eval2(point) - radius; }
+};
+
+// One colour all over.
+template<typename T>
+struct Flat {
+  Vec3<T> rgb;
+  glm::vec3 colour(glm::vec3) const { return vec(rgb); }
+};
+
+// Looks down +z from the origin: pupil, sclera and outline are rings
+// around the axis, by the cosine of the angle to it.
+template<typename T>
+struct Eye {
+  Vec3<T> base;
+  Vec3<T> pupil;  // Also the outline.
+  Vec3<T> sclera;
+  T pupil_cos;
+  T sclera_cos;
+  T outline_cos;
+  glm::vec3 colour(glm::vec3 point) const {
+    float d = glm::normalize(point).z;
+    if (d > pupil_cos) return vec(pupil);
+    if (d > sclera_cos) return vec(sclera);
+    if (d > outline_cos) return vec(pupil);
+    return vec(base);
+  }
+};
+
+// Gives the child material `id`, coloured by `paint` at the point as the
+// child sees it.
+template<typename P, typename N>
+struct Material {
+  float id;
+  P paint;
+  N child;
+  glm::vec2 eval(glm::vec3 point) const { return glm::vec2(child.eval(point).x, id); }
+};
+//===== Section: Distance =====//
+
+//===== Section: Combinators =====//
+// The nearer of the two, `a` on ties like `if (d < res.x) res = ...`.
+template<Sdf3 A, Sdf3 B>
+struct Union {
+  A a;
+  B b;
+  glm::vec2 eval(glm::vec3 point) const {
+    glm::vec2 res = a.eval(point);
+    glm::vec2 other = b.eval(point);
+    return other.x < res.x ? other : res;
+  }
+};
+
+// `a` with `b` cut out, keeps a's material.
+template<Sdf3 A, Sdf3 B>
+struct Subtract {
+  A a;
+  B b;
+  glm::vec2 eval(glm::vec3 point) const {
+    glm::vec2 res = a.eval(point);
+    res.x = glm::max(-b.eval(point).x, res.x);
+    return res;
+  }
+};
+
+// sdfOpSmoothMin, with the material of the nearer one.
+template<typename T, Sdf3 A, Sdf3 B>
+struct SmoothUnion {
+  T k;
+  A a;
+  B b;
+  glm::vec2 eval(glm::vec3 point) const {
+    glm::vec2 res = a.eval(point);
+    glm::vec2 other = b.eval(point);
+    return glm::vec2(sdfOpSmoothMin(res.x, other.x, k), other.x < res.x ? other.y : res.y);
+  }
+};
+
+// `bound` is part of the shape, `inner` is only evaluated where bound is
+// nearer than `within`, like magnemite's `if (body - 1 < 0)`.
+template<typename T, Sdf3 B, Sdf3 N>
+struct Bound {
+  T within;
+  B bound;
+  N inner;
+  glm::vec2 eval(glm::vec3 point) const {
+    glm::vec2 res = bound.eval(point);
+    if (res.x - within < 0) {
+      glm::vec2 other = inner.eval(point);
+      if (other.x < res.x) res = other;
+    }
+    return res;
+  }
+};
+
+// The child only where axis < limit (or > limit when `Above`), nothing
+// elsewhere. Not a distance bound, use it for parts far from the boundary.
+template<int Axis, bool Above, typename T, Sdf3 N>
+struct Region {
+  T limit;
+  N child;
+  glm::vec2 eval(glm::vec3 point) const {
+    float value = point[Axis];
+    if (Above ? !(value > limit) : !(value < limit)) {
+      return glm::vec2(std::numeric_limits<float>::max(), CPU_UNKNOWN_MAT);
+    }
+    return child.eval(point);
+  }
+};
+//===== Section: Combinators =====//
+
+//===== Section: Colour =====//
+// The colour of material `id` at `point`, from the first Material node with
+// that id. False if there is none.
+template<typename N>
+bool findColour(const N &, float, glm::vec3, glm::vec3 &) { return false; }
+
+template<DomainOp N>
+bool findColour(const N &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.child, id, node.apply(point), out);
+}
+
+template<typename T, typename N>
+bool findColour(const Round<T, N> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.child, id, point, out);
+}
+
+template<typename P, typename N>
+bool findColour(const Material<P, N> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  if (glm::abs(id - node.id) < 0.5f) {
+    out = node.paint.colour(point);
+    return true;
+  }
+  return findColour(node.child, id, point, out);
+}
+
+template<typename A, typename B>
+bool findColour(const Union<A, B> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.a, id, point, out) || findColour(node.b, id, point, out);
+}
+
+template<typename A, typename B>
+bool findColour(const Subtract<A, B> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.a, id, point, out) || findColour(node.b, id, point, out);
+}
+
+template<typename T, typename A, typename B>
+bool findColour(const SmoothUnion<T, A, B> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.a, id, point, out) || findColour(node.b, id, point, out);
+}
+
+template<typename T, typename B, typename N>
+bool findColour(const Bound<T, B, N> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.bound, id, point, out) || findColour(node.inner, id, point, out);
+}
+
+template<int Axis, bool Above, typename T, typename N>
+bool findColour(const Region<Axis, Above, T, N> &node, float id, glm::vec3 point, glm::vec3 &out) {
+  return findColour(node.child, id, point, out);
+}
+
+// sceneColor() of a scene, magenta for UNKNOWN_MAT and ids it does not have.
+template<Sdf3 N>
+glm::vec3 sceneColour(const N &scene, float id, glm::vec3 point) {
+  glm::vec3 colour(1.0f, 0.0f, 1.0f);
+  findColour(scene, id, point, colour);
+  return colour;
+}
+//===== Section: Colour =====//
+
+//===== Section: Builders =====//
+template<typename T> Sphere<T> sphere(T radius) { return {radius}; }
+template<typename T> Box<T> box(T x, T y, T z) { return {{x, y, z}}; }
+template<typename T> CutSphere<T> cutSphere(T radius, T height) { return {radius, height}; }
+template<typename T> VerticalCapsule<T> verticalCapsule(T height, T radius) { return {height, radius}; }
+template<typename T> Cone<T> cone(T sin_angle, T cos_angle, T height) { return {{sin_angle, cos_angle}, height}; }
+template<typename T> PlaneY<T> planeY(T height) { return {height}; }
+template<typename T> Vesica2D<T> vesica2D(T radius, T offset) { return {radius, offset}; }
+template<typename T>
+Horseshoe2D<T> horseshoe2D(T curve_cos, T curve_sin, T inner_radius, T arm_length, T arm_thickness) {
+  return {{curve_cos, curve_sin}, inner_radius, {arm_length, arm_thickness}};
+}
+
+template<typename T, typename N> Translate<T, N> translate(T x, T y, T z, N child) { return {{x, y, z}, std::move(child)}; }
+template<typename T, typename N> Transform<T, N> transform(Affine<T> affine, N child) { return {affine, std::move(child)}; }
+template<typename T, typename N> TwistY<T, N> twistY(T amount, N child) { return {amount, std::move(child)}; }
+template<typename T, typename N> Repeat<T, N> repeat(T scale, N child) { return {{scale, scale}, std::move(child)}; }
+template<typename T, typename N>
+RepeatClamped<T, N> repeatClamped(T scale, T limit, N child) { return {{scale, scale}, {limit, limit}, std::move(child)}; }
+template<int Axis, int Flip = -1, typename N> Mirror<Axis, Flip, N> mirror(N child) { return {std::move(child)}; }
+template<typename T, typename N> Scale<T, N> scale(T factor, N child) { return {factor, std::move(child)}; }
+template<typename T, typename N> SwayX<T, N> swayX(T strength, N child) { return {strength, std::move(child)}; }
+
+template<typename T, Sdf2 N> Extrude<T, N> extrude(T amount, N child) { return {amount, std::move(child)}; }
+template<typename T, typename N> Round<T, N> round(T radius, N child) { return {radius, std::move(child)}; }
+template<typename T> Flat<T> flat(T r, T g, T b) { return {{r, g, b}}; }
+template<typename P, typename N> Material<P, N> material(float id, P paint, N child) { return {id, paint, std::move(child)}; }
+
+template<Sdf3 A, Sdf3 B> Union<A, B> operator|(A a, B b) { return {std::move(a), std::move(b)}; }
+template<Sdf3 A, Sdf3 B> Subtract<A, B> operator-(A a, B b) { return {std::move(a), std::move(b)}; }
+template<typename T, Sdf3 A, Sdf3 B>
+SmoothUnion<T, A, B> smoothUnion(T k, A a, B b) { return {k, std::move(a), std::move(b)}; }
+template<typename T, Sdf3 B, Sdf3 N> Bound<T, B, N> bound(T within, B bound, N inner) { return {within, std::move(bound), std::move(inner)}; }
+template<int Axis, typename T, Sdf3 N> Region<Axis, false, T, N> below(T limit, N child) { return {limit, std::move(child)}; }
+template<int Axis, typename T, Sdf3 N> Region<Axis, true, T, N> above(T limit, N child) { return {limit, std::move(child)}; }
+//===== Section: Builders =====//
+
+}  // namespace sdf
+
+#endif
@@ -0,0 +1,60 @@
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "magnemite_sdf.hpp"
+#include "sdf_glsl.hpp"
+
+/* Writes the shaders of the scenes written with sdf_dsl.hpp, for
+   ray_marcher.glsl. Run after changing one, the output is checked in so
+   that the app does not need this to build.
+*/
+
+struct GeneratedScene {
+  const char *file;
+  const char *source;  // Where the scene is written.
+  std::string (*glsl)();
+};
+
+static const GeneratedScene scenes[] = {
+  {
+    .file = "magnemite-sdf.glsl",
+    .source = "src/magnemite_sdf.hpp",
+    .glsl = []() { return sdf::glslScene(magnemiteSdf(sdf::GlslFloat::code("itime"))); },
+  },
+};
+
+static bool writeScene(const std::string &path, const GeneratedScene &scene) {
+  std::ofstream out{path, std::ios::binary};
+  out << "#version 330\n\n"
+      << "// Generated from " << scene.source << " by final-sdfgen, do not edit.\n\n"
+      << "#include \"util/common.glsl\"\n"
+      << "#include \"util/sdf-decl.glsl\"\n\n"
+      << scene.glsl();
+  return (bool)out;
+}
+
+int main(int argc, char **argv) {
+  auto logger = std::make_shared<spdlog::logger>("logger", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+  spdlog::register_logger(logger);
+  spdlog::set_default_logger(logger);
+
+  if (argc > 2 || (argc == 2 && std::string(argv[1]) == "--help")) {
+    spdlog::info("Usage: final-sdfgen [DIR]");
+    spdlog::info("  Writes the generated scene shaders to DIR (shaders)");
+    return argc > 2 ? -1 : 0;
+  }
+  std::string dir = argc == 2 ? argv[1] : "shaders";
+
+  for (auto &scene : scenes) {
+    std::string path = dir + "/" + scene.file;
+    if (!writeScene(path, scene)) {
+      spdlog::error("SDF: Could not write {}!", path);
+      return -1;
+    }
+    spdlog::info("SDF: Wrote {}", path);
+  }
+}
@@ -0,0 +1,567 @@
+#ifndef CSCI_4110U_SDF_GLSL_H
+#define CSCI_4110U_SDF_GLSL_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "sdf_dsl.hpp"
+
+/* Writes an sdf_dsl.hpp scene out as the scene() and sceneColor() of a
+   shader for ray_marcher.glsl, so the GPU draws exactly what the CPU
+   renderer evaluates.
+
+   Build the scene with GlslFloat parameters: values worked out from
+   constants are folded by the C++ compiler's float maths, the same as the
+   CPU's, anything that depends on a uniform stays an expression. Each
+   distinct subexpression of those is worked out once at the top of the
+   function that uses it. Transforms are written as the dot products that
+   are left after dropping zero and unit terms.
+*/
+
+namespace sdf {
+
+// Shortest GLSL float literal that reads back as the same float.
+inline std::string glslLiteral(float value) {
+  char text[32];
+  for (int digits = 6; digits <= 9; digits++) {
+    std::snprintf(text, sizeof(text), "%.*g", digits, value);
+    if (std::strtof(text, nullptr) == value) break;
+  }
+  std::string literal = text;
+  if (literal.find_first_of(".en") == std::string::npos) literal += ".0";
+  return literal;
+}
+
+// A float parameter that is either a constant or an expression of
+// uniforms, kept as a tree so that equal subexpressions can be shared.
+class GlslFloat {
+  float constant_value = 0.0f;
+  std::string head{};  // Empty for a constant, else a uniform, operator or function.
+  std::shared_ptr<const std::vector<GlslFloat>> args{};  // Null for a uniform.
+
+  public:
+    GlslFloat(float value) : constant_value(value) {}
+
+    // A uniform, e.g. "itime".
+    static GlslFloat code(std::string uniform) {
+      GlslFloat result{0.0f};
+      result.head = std::move(uniform);
+      return result;
+    }
+    // An operator (+ - * /, - with one operand) or a function call.
+    static GlslFloat apply(std::string op, std::vector<GlslFloat> operands) {
+      GlslFloat result = code(std::move(op));
+      result.args = std::make_shared<const std::vector<GlslFloat>>(std::move(operands));
+      return result;
+    }
+
+    bool constant() const { return head.empty(); }
+    bool is(float value) const { return constant() && constant_value == value; }
+    float value() const { return constant_value; }
+    bool uniform() const { return !constant() && !args; }
+    const std::string &op() const { return head; }
+    const std::vector<GlslFloat> &operands() const { return *args; }
+};
+
+// op() applied to operands already written out.
+inline std::string glslApply(const std::string &op, const std::vector<std::string> &operands) {
+  if (operands.size() == 1 && op == "-") return "-" + operands[0];
+  if (operands.size() == 2 && op.size() == 1) return operands[0] + " " + op + " " + operands[1];
+  std::string call = op + "(";
+  for (size_t i = 0; i < operands.size(); i++) call += (i ? ", " : "") + operands[i];
+  return call + ")";
+}
+
+inline GlslFloat glslBinary(const GlslFloat &a, const char *op, const GlslFloat &b) {
+  return GlslFloat::apply(op, {a, b});
+}
+
+inline GlslFloat operator+(const GlslFloat &a, const GlslFloat &b) {
+  if (a.constant() && b.constant()) return a.value() + b.value();
+  if (a.is(0.0f)) return b;
+  if (b.is(0.0f)) return a;
+  return glslBinary(a, "+", b);
+}
+
+inline GlslFloat operator-(const GlslFloat &a, const GlslFloat &b) {
+  if (a.constant() && b.constant()) return a.value() - b.value();
+  if (b.is(0.0f)) return a;
+  return glslBinary(a, "-", b);
+}
+
+inline GlslFloat operator*(const GlslFloat &a, const GlslFloat &b) {
+  if (a.constant() && b.constant()) return a.value() * b.value();
+  if (a.is(0.0f) || b.is(0.0f)) return 0.0f;  // Uniforms are finite.
+  if (a.is(1.0f)) return b;
+  if (b.is(1.0f)) return a;
+  return glslBinary(a, "*", b);
+}
+
+inline GlslFloat operator/(const GlslFloat &a, const GlslFloat &b) {
+  if (a.constant() && b.constant()) return a.value() / b.value();
+  if (b.is(1.0f)) return a;
+  return glslBinary(a, "/", b);
+}
+
+inline GlslFloat operator-(const GlslFloat &a) {
+  if (a.constant()) return -a.value();
+  return GlslFloat::apply("-", {a});
+}
+
+#define SDF_GLSL_FUNCTION(NAME)                                                 \
+  inline GlslFloat NAME(const GlslFloat &a) {                                   \
+    if (a.constant()) return NAME(a.value());                                   \
+    return GlslFloat::apply(#NAME, {a});                                        \
+  }
+SDF_GLSL_FUNCTION(sin)
+SDF_GLSL_FUNCTION(cos)
+SDF_GLSL_FUNCTION(floor)
+SDF_GLSL_FUNCTION(sign)
+#undef SDF_GLSL_FUNCTION
+
+inline GlslFloat max(const GlslFloat &a, const GlslFloat &b) {
+  if (a.constant() && b.constant()) return max(a.value(), b.value());
+  return GlslFloat::apply("max", {a, b});
+}
+
+inline GlslFloat mod(const GlslFloat &a, const GlslFloat &b) {
+  if (a.constant() && b.constant()) return mod(a.value(), b.value());
+  return GlslFloat::apply("mod", {a, b});
+}
+
+/* A function body being written. Every value gets its own variable, the
+   driver's compiler is left to fold them. Expressions of uniforms get one
+   variable per distinct subexpression, declared at the top whichever
+   branch first needs them, and left out if the body ends up not using them.
+*/
+class GlslWriter {
+  std::vector<std::pair<std::string, std::string>> hoisted{};  // Name, expression.
+  std::map<std::string, std::string> hoisted_names{};          // Expression -> name.
+  std::string body{};
+  int next = 0;
+  int depth;
+
+  public:
+    explicit GlslWriter(int depth = 1) : depth(depth) {}
+
+    std::string value(const GlslFloat &value) {
+      if (value.constant()) return glslLiteral(value.value());
+      if (value.uniform()) return value.op();
+
+      // Operands first, so equal subexpressions come out as the same text.
+      std::vector<std::string> operands;
+      for (auto &operand : value.operands()) operands.push_back(this->value(operand));
+      std::string expression = glslApply(value.op(), operands);
+      auto [it, added] = hoisted_names.try_emplace(expression, "u" + std::to_string(next));
+      if (added) {
+        next++;
+        hoisted.emplace_back(it->second, expression);
+      }
+      return it->second;
+    }
+    template<typename T> std::string vec(const Vec2<T> &v) { return "vec2(" + value(v.x) + ", " + value(v.y) + ")"; }
+    template<typename T> std::string vec(const Vec3<T> &v) {
+      return "vec3(" + value(v.x) + ", " + value(v.y) + ", " + value(v.z) + ")";
+    }
+
+    // `type name = expression;`, returns the name: p for points, r for
+    // results, d for distances.
+    std::string declare(const std::string &type, const std::string &expression) {
+      std::string name = (type == "vec3" ? "p" : type == "vec2" ? "r" : "d") + std::to_string(next++);
+      line(type + " " + name + " = " + expression + ";");
+      return name;
+    }
+    void line(const std::string &code) { body += std::string(depth * 4, ' ') + code + "\n"; }
+    void open(const std::string &head) {
+      line(head + " {");
+      depth++;
+    }
+    void close() {
+      depth--;
+      line("}");
+    }
+
+    // Statements written since mark() are dropped by rewind().
+    size_t mark() const { return body.size(); }
+    void rewind(size_t mark) { body.resize(mark); }
+    std::string since(size_t mark) const { return body.substr(mark); }
+
+    std::string function(const std::string &signature, const std::string &tail = "") const {
+      // Hoisted values only refer to earlier ones, walk back from the body.
+      static const std::regex hoisted_name{"\\bu[0-9]+\\b"};
+      std::set<std::string> used;
+      auto use = [&](const std::string &code) {
+        for (std::sregex_iterator it{code.begin(), code.end(), hoisted_name}, end; it != end; ++it) used.insert(it->str());
+      };
+      use(body + tail);
+      std::string declarations;
+      for (auto it = hoisted.rbegin(); it != hoisted.rend(); ++it) {
+        if (!used.count(it->first)) continue;
+        use(it->second);
+        declarations = "    float " + it->first + " = " + it->second + ";\n" + declarations;
+      }
+      return signature + " {\n" + declarations + body + tail + "}\n";
+    }
+};
+
+// A distance and material, both GLSL expressions.
+struct GlslRes {
+  std::string dist;
+  std::string mat;
+};
+
+// As a vec2, the variable itself when both come from one.
+inline std::string glslVec2(const GlslRes &res) {
+  size_t dot = res.dist.size() - 2;
+  if (res.dist.ends_with(".x") && res.mat == res.dist.substr(0, dot) + ".y") return res.dist.substr(0, dot);
+  return "vec2(" + res.dist + ", " + res.mat + ")";
+}
+
+inline constexpr const char *GLSL_UNKNOWN_MAT = "UNKNOWN_MAT";
+
+//===== Section: Primitives =====//
+template<typename T>
+GlslRes glsl(GlslWriter &w, const Sphere<T> &node, const std::string &p) {
+  return {w.declare("float", "sdfSphere(" + p + ", " + w.value(node.radius) + ")"), GLSL_UNKNOWN_MAT};
+}
+
+template<typename T>
+GlslRes glsl(GlslWriter &w, const Box<T> &node, const std::string &p) {
+  return {w.declare("float", "sdfBox(" + p + ", " + w.vec(node.half_size) + ")"), GLSL_UNKNOWN_MAT};
+}
+
+template<typename T>
+GlslRes glsl(GlslWriter &w, const CutSphere<T> &node, const std::string &p) {
+  return {w.declare("float", "sdfCutSphere(" + p + ", " + w.value(node.radius) + ", " + w.value(node.height) + ")"),
+          GLSL_UNKNOWN_MAT};
+}
+
+template<typename T>
+GlslRes glsl(GlslWriter &w, const VerticalCapsule<T> &node, const std::string &p) {
+  return {w.declare("float", "sdfVerticalCapsule(" + p + ", " + w.value(node.height) + ", " + w.value(node.radius) + ")"),
+          GLSL_UNKNOWN_MAT};
+}
+
+template<typename T>
+GlslRes glsl(GlslWriter &w, const Cone<T> &node, const std::string &p) {
+  return {w.declare("float", "sdfCone(" + p + ", " + w.vec(node.sc_angle) + ", " + w.value(node.height) + ")"),
+          GLSL_UNKNOWN_MAT};
+}
+
+template<typename T>
+GlslRes glsl(GlslWriter &w, const PlaneY<T> &node, const std::string &p) {
+  return {w.declare("float", p + ".y - " + w.value(node.height)), GLSL_UNKNOWN_MAT};
+}
+
+template<typename T>
+std::string glsl2(GlslWriter &w, const Vesica2D<T> &node, const std::string &p) {
+  return w.declare("float", "sdfVesica2D(" + p + ", " + w.value(node.radius) + ", " + w.value(node.offset) + ")");
+}
+
+template<typename T>
+std::string glsl2(GlslWriter &w, const Horseshoe2D<T> &node, const std::string &p) {
+  return w.declare("float", "sdfHorseshoe2D(" + p + ", " + w.vec(node.curve) + ", " + w.value(node.inner_radius) +
+                            ", " + w.vec(node.arm) + ")");
+}
+//===== Section: Primitives =====//
+
+//===== Section: Domain =====//
+// glslPoint() writes a domain operation's point and returns its name.
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const Translate<T, N> &node, const std::string &p) {
+  const Vec3<T> &o = node.offset;
+  if (GlslFloat(o.x).is(0.0f) && GlslFloat(o.y).is(0.0f) && GlslFloat(o.z).is(0.0f)) return p;
+  return w.declare("vec3", p + " - " + w.vec(o));
+}
+
+// One row of an affine transform, without the zero and unit products.
+template<typename T>
+std::string glslRow(GlslWriter &w, const Vec3<T> &row, const T &offset, const std::string &p) {
+  const T *coefficients[] = {&row.x, &row.y, &row.z};
+  std::string sum;
+  for (int i = 0; i < 3; i++) {
+    GlslFloat c{*coefficients[i]};
+    if (c.is(0.0f)) continue;
+    std::string term = p + "." + "xyz"[i];
+    if (c.is(-1.0f)) {
+      term = "-" + term;
+    } else if (!c.is(1.0f)) {
+      term = w.value(c) + " * " + term;
+    }
+    sum += sum.empty() ? term : " + " + term;
+  }
+  GlslFloat o{offset};
+  if (!o.is(0.0f)) sum += sum.empty() ? w.value(o) : " + " + w.value(o);
+  return sum.empty() ? "0.0" : sum;
+}
+
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const Transform<T, N> &node, const std::string &p) {
+  const Affine<T> &a = node.affine;
+  return w.declare("vec3", "vec3(" + glslRow(w, a.rows[0], a.offset.x, p) + ", " + glslRow(w, a.rows[1], a.offset.y, p) +
+                           ", " + glslRow(w, a.rows[2], a.offset.z, p) + ")");
+}
+
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const TwistY<T, N> &node, const std::string &p) {
+  return w.declare("vec3", "sdfOpTwistY(" + p + ", " + w.value(node.amount) + ")");
+}
+
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const Repeat<T, N> &node, const std::string &p) {
+  std::string q = w.declare("vec3", p);
+  w.line(q + ".xz = sdfOpRepeat2D(" + q + ".xz, " + w.vec(node.scale) + ");");
+  return q;
+}
+
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const RepeatClamped<T, N> &node, const std::string &p) {
+  std::string q = w.declare("vec3", p);
+  w.line(q + ".xz = sdfOpRepeat2DClamped(" + q + ".xz, " + w.vec(node.scale) + ", " + w.vec(node.limit) + ");");
+  return q;
+}
+
+template<int Axis, int Flip, typename N>
+std::string glslPoint(GlslWriter &w, const Mirror<Axis, Flip, N> &, const std::string &p) {
+  std::string axis = p + "." + "xyz"[Axis];
+  std::string q = w.declare("vec3", p);
+  w.line(q + "." + "xyz"[Axis] + " = abs(" + axis + ");");
+  if constexpr (Flip >= 0) {
+    std::string flip = q + "." + "xyz"[Flip];
+    w.line("if (" + axis + " > 0.0) " + flip + " = -" + flip + ";");
+  }
+  return q;
+}
+
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const Scale<T, N> &node, const std::string &p) {
+  return w.declare("vec3", p + " * " + w.value(node.factor));
+}
+
+template<typename T, typename N>
+std::string glslPoint(GlslWriter &w, const SwayX<T, N> &node, const std::string &p) {
+  std::string fy = w.declare("float", "fract(" + p + ".y)");
+  std::string q = w.declare("vec3", p);
+  w.line(q + ".x -= -" + fy + " * " + fy + " * " + fy + " * " + w.value(node.strength) + ";");
+  return q;
+}
+
+template<typename N>
+concept GlslDomainOp = requires(GlslWriter &w, const N &node, const std::string &p) {
+  { glslPoint(w, node, p) } -> std::same_as<std::string>;
+};
+
+template<GlslDomainOp N>
+GlslRes glsl(GlslWriter &w, const N &node, const std::string &p) {
+  return glsl(w, node.child, glslPoint(w, node, p));
+}
+
+template<typename T, typename N>
+GlslRes glsl(GlslWriter &w, const Scale<T, N> &node, const std::string &p) {
+  GlslRes res = glsl(w, node.child, glslPoint(w, node, p));
+  return {w.declare("float", res.dist + " / " + w.value(node.factor)), res.mat};
+}
+//===== Section: Domain =====//
+
+//===== Section: Distance =====//
+template<typename T, typename N>
+GlslRes glsl(GlslWriter &w, const Extrude<T, N> &node, const std::string &p) {
+  std::string d = glsl2(w, node.child, p + ".xy");
+  return {w.declare("float", "sdfOpExtrude(" + p + ", " + d + ", " + w.value(node.amount) + ")"), GLSL_UNKNOWN_MAT};
+}
+
+template<typename T, typename N>
+GlslRes glsl(GlslWriter &w, const Round<T, N> &node, const std::string &p) {
+  GlslRes res = glsl(w, node.child, p);
+  return {w.declare("float", res.dist + " - " + w.value(node.radius)), res.mat};
+}
+
+template<typename T, typename N>
+std::string glsl2(GlslWriter &w, const Round<T, N> &node, const std::string &p) {
+  return w.declare("float", glsl2(w, node.child, p) + " - " + w.value(node.radius));
+}
+
+template<typename P, typename N>
+GlslRes glsl(GlslWriter &w, const Material<P, N> &node, const std::string &p) {
+  return {glsl(w, node.child, p).dist, w.value(node.id)};
+}
+//===== Section: Distance =====//
+
+//===== Section: Combinators =====//
+// `if (d < res.x) res = ...`, as a select, or a min() when the material is
+// the same either way.
+inline GlslRes glslNearer(GlslWriter &w, const GlslRes &a, const GlslRes &b) {
+  if (a.mat == b.mat) return {w.declare("float", "min(" + a.dist + ", " + b.dist + ")"), a.mat};
+  std::string r = w.declare("vec2", b.dist + " < " + a.dist + " ? " + glslVec2(b) + " : " + glslVec2(a));
+  return {r + ".x", r + ".y"};
+}
+
+template<typename A, typename B>
+GlslRes glsl(GlslWriter &w, const Union<A, B> &node, const std::string &p) {
+  GlslRes a = glsl(w, node.a, p);
+  return glslNearer(w, a, glsl(w, node.b, p));
+}
+
+template<typename A, typename B>
+GlslRes glsl(GlslWriter &w, const Subtract<A, B> &node, const std::string &p) {
+  GlslRes a = glsl(w, node.a, p);
+  GlslRes b = glsl(w, node.b, p);
+  return {w.declare("float", "max(-" + b.dist + ", " + a.dist + ")"), a.mat};
+}
+
+template<typename T, typename A, typename B>
+GlslRes glsl(GlslWriter &w, const SmoothUnion<T, A, B> &node, const std::string &p) {
+  GlslRes a = glsl(w, node.a, p);
+  GlslRes b = glsl(w, node.b, p);
+  std::string d = w.declare("float", "sdfOpSmoothMin(" + a.dist + ", " + b.dist + ", " + w.value(node.k) + ")");
+  if (a.mat == b.mat) return {d, a.mat};
+  return {d, w.declare("float", b.dist + " < " + a.dist + " ? " + b.mat + " : " + a.mat)};
+}
+
+template<typename T, typename B, typename N>
+GlslRes glsl(GlslWriter &w, const Bound<T, B, N> &node, const std::string &p) {
+  GlslRes bound = glsl(w, node.bound, p);
+  std::string r = w.declare("vec2", glslVec2(bound));
+  w.open("if (" + r + ".x - " + w.value(node.within) + " < 0.0)");
+  GlslRes inner = glsl(w, node.inner, p);
+  w.line("if (" + inner.dist + " < " + r + ".x) " + r + " = " + glslVec2(inner) + ";");
+  w.close();
+  return {r + ".x", r + ".y"};
+}
+
+template<int Axis, bool Above, typename T, typename N>
+GlslRes glsl(GlslWriter &w, const Region<Axis, Above, T, N> &node, const std::string &p) {
+  std::string r = w.declare("vec2", "vec2(" + glslLiteral(std::numeric_limits<float>::max()) + ", " + GLSL_UNKNOWN_MAT + ")");
+  w.open("if (" + p + "." + "xyz"[Axis] + (Above ? " > " : " < ") + w.value(node.limit) + ")");
+  GlslRes child = glsl(w, node.child, p);
+  w.line(r + " = " + glslVec2(child) + ";");
+  w.close();
+  return {r + ".x", r + ".y"};
+}
+//===== Section: Combinators =====//
+
+//===== Section: Colour =====//
+// The body of one material's branch of sceneColor().
+struct GlslPaint {
+  float id;
+  std::string code;
+  bool uses_point;
+};
+
+template<typename T>
+void glslPaint(GlslWriter &w, const Flat<T> &paint, const std::string &) {
+  w.line("return " + w.vec(paint.rgb) + ";");
+}
+
+template<typename T>
+void glslPaint(GlslWriter &w, const Eye<T> &paint, const std::string &p) {
+  std::string d = w.declare("float", "normalize(" + p + ").z");
+  w.line("if (" + d + " > " + w.value(paint.pupil_cos) + ") return " + w.vec(paint.pupil) + ";");
+  w.line("if (" + d + " > " + w.value(paint.sclera_cos) + ") return " + w.vec(paint.sclera) + ";");
+  w.line("if (" + d + " > " + w.value(paint.outline_cos) + ") return " + w.vec(paint.pupil) + ";");
+  w.line("return " + w.vec(paint.base) + ";");
+}
+
+template<typename T> constexpr bool glslPaintUsesPoint(const Flat<T> &) { return false; }
+template<typename T> constexpr bool glslPaintUsesPoint(const Eye<T> &) { return true; }
+
+/* Collects the paint of every material, like findColour(). `w` holds the
+   statements that move the point from the scene's to the node's, the
+   domain operations on the way down.
+*/
+template<typename N>
+void glslPaints(GlslWriter &, std::vector<GlslPaint> &, const N &, const std::string &) {}
+
+template<GlslDomainOp N>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const N &node, const std::string &p) {
+  size_t mark = w.mark();
+  glslPaints(w, paints, node.child, glslPoint(w, node, p));
+  w.rewind(mark);
+}
+
+template<typename T, typename N>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const Round<T, N> &node, const std::string &p) {
+  glslPaints(w, paints, node.child, p);
+}
+
+template<int Axis, bool Above, typename T, typename N>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const Region<Axis, Above, T, N> &node, const std::string &p) {
+  glslPaints(w, paints, node.child, p);
+}
+
+template<typename P, typename N>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const Material<P, N> &node, const std::string &p) {
+  bool seen = std::any_of(paints.begin(), paints.end(), [&](const GlslPaint &paint) { return paint.id == node.id; });
+  if (!seen) {
+    bool uses_point = glslPaintUsesPoint(node.paint);
+    size_t mark = w.mark();
+    glslPaint(w, node.paint, p);
+    paints.push_back(GlslPaint{.id = node.id, .code = w.since(uses_point ? 0 : mark), .uses_point = uses_point});
+    w.rewind(mark);
+  }
+  glslPaints(w, paints, node.child, p);
+}
+
+template<typename A, typename B>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const Union<A, B> &node, const std::string &p) {
+  glslPaints(w, paints, node.a, p);
+  glslPaints(w, paints, node.b, p);
+}
+
+template<typename A, typename B>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const Subtract<A, B> &node, const std::string &p) {
+  glslPaints(w, paints, node.a, p);
+  glslPaints(w, paints, node.b, p);
+}
+
+template<typename T, typename A, typename B>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const SmoothUnion<T, A, B> &node, const std::string &p) {
+  glslPaints(w, paints, node.a, p);
+  glslPaints(w, paints, node.b, p);
+}
+
+template<typename T, typename B, typename N>
+void glslPaints(GlslWriter &w, std::vector<GlslPaint> &paints, const Bound<T, B, N> &node, const std::string &p) {
+  glslPaints(w, paints, node.bound, p);
+  glslPaints(w, paints, node.inner, p);
+}
+//===== Section: Colour =====//
+
+// scene() and sceneColor() of a scene, for ray_marcher.glsl.
+template<typename N>
+std::string glslScene(const N &scene) {
+  GlslWriter distance;
+  GlslRes res = glsl(distance, scene, "point");
+  std::string source = distance.function("vec2 scene(in vec3 point)", "    return " + glslVec2(res) + ";\n");
+
+  // One branch per material in order of id, matched the way findColour()
+  // does so that ids the scene does not have are magenta on both.
+  GlslWriter colour{2};
+  std::vector<GlslPaint> paints;
+  glslPaints(colour, paints, scene, "point");
+  std::sort(paints.begin(), paints.end(), [](const GlslPaint &a, const GlslPaint &b) { return a.id < b.id; });
+
+  std::string branches;
+  for (auto &paint : paints) {
+    std::string test = "    if (abs(id - " + glslLiteral(paint.id) + ") < 0.5)";
+    if (paint.uses_point) {
+      branches += test + " {\n" + paint.code + "    }\n";
+    } else {
+      branches += test + " " + paint.code.substr(paint.code.find_first_not_of(' '));
+    }
+  }
+  branches += "    return vec3(1.0, 0.0, 1.0);\n";
+  return source + "\n" + colour.function("vec3 sceneColor(float id, vec3 point)", branches);
+}
+
+}  // namespace sdf
+
+#endif
@@ -0,0 +1,215 @@
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "gl_extensions.hpp"
+#include "section_profiler.hpp"
+#include "shader_sections.hpp"
+
+#define PROFILE_SHADER_PATH "<section-profile>"
+
+SectionProfiler::SectionProfiler() {
+  clock = hasExtension("GL_ARB_shader_clock");
+  spdlog::info("Section profiler: {}", clock ? "ARB_shader_clock cycles and evaluations" : "evaluations only");
+
+  for (auto &readback : readbacks) {
+    glGenBuffers(1, &readback.ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, readback.ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * MAX_SECTIONS * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+  }
+  glGenBuffers(1, &overflow_ssbo);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflow_ssbo);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * MAX_SECTIONS * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+SectionProfiler::~SectionProfiler() {
+  for (auto &readback : readbacks) {
+    if (readback.fence) glDeleteSync(readback.fence);
+    glDeleteBuffers(1, &readback.ssbo);
+  }
+  glDeleteBuffers(1, &overflow_ssbo);
+}
+
+bool SectionProfiler::supported() {
+  return GLAD_GL_VERSION_4_3;
+}
+
+int SectionProfiler::sectionId(const std::string &name) {
+  auto found = std::find(names.begin(), names.end(), name);
+  if (found != names.end()) return found - names.begin();
+
+  if ((int)names.size() == MAX_SECTIONS) return -1;
+  names.push_back(name);
+  costs.push_back({.name = name});
+  return names.size() - 1;
+}
+
+std::string SectionProfiler::instrument(const Shader &shader, const std::string &source) {
+  if (shader.type != GL_FRAGMENT_SHADER || shader.path == PROFILE_SHADER_PATH) return source;
+
+  auto lines = splitLines(source);
+  // Instrumentation is prepended to the marker lines so line numbers in
+  // compile errors stay the same as in the file.
+  for (auto &section : findSections(lines)) {
+    int id = sectionId(section.name);
+    if (id < 0) {
+      spdlog::warn("  {}: Too many sections, not profiling {}", shader.path, section.name);
+      continue;
+    }
+
+    std::string start = "_prof_t" + std::to_string(section.begin_line);
+    std::string end = "profileEnd(" + std::to_string(id) + ", " + start + ");";
+    if (section.in_function) {
+      lines[section.begin_line] = "uint " + start + " = profileBegin(); " + lines[section.begin_line];
+      lines[section.end_line] = end + " " + lines[section.end_line];
+      continue;
+    }
+    if (section.function.empty()) {
+      spdlog::warn("  {}: Section {} is not a function body, not profiled", shader.path, section.name);
+      continue;
+    }
+
+    // Section around a function: rename it and wrap the renamed function.
+    auto renamed = section.function + "_unprofiled";
+    auto call = renamed + "(" + callArguments(section.params) + ")";
+    auto wrapper = section.return_type + " " + section.function + "(" + section.params + ") { "
+                 + "uint " + start + " = profileBegin(); ";
+    if (section.return_type == "void") {
+      wrapper += call + "; " + end + " } ";
+    } else {
+      wrapper += section.return_type + " r = " + call + "; " + end + " return r; } ";
+    }
+    renameFunction(lines, section, renamed);
+    lines[section.end_line] = wrapper + lines[section.end_line];
+  }
+
+  std::string result = joinLines(lines);
+  if (result.rfind("#version", 0) == 0) {
+    result.insert(result.find('\n') + 1,
+      "#define PROFILE_SECTIONS\n"
+      "uint profileBegin();\n"
+      "void profileEnd(int section, uint start);\n"
+      "#line 2\n");
+  }
+  return result;
+}
+
+Shader SectionProfiler::profileShader() const {
+  std::string zeros;
+  for (int i = 0; i < MAX_SECTIONS; i++) zeros += i == 0 ? "0u" : ", 0u";
+
+  std::string source = "#version 430\n";
+  if (clock) source += "#extension GL_ARB_shader_clock : require\n#define PROFILE_CLOCK\n";
+  source +=
+    "const int MAX_SECTIONS = " + std::to_string(MAX_SECTIONS) + ";\n"
+    "layout(std430, binding = 0) buffer SectionProfile {\n"
+    "    uint total_evaluations[MAX_SECTIONS];\n"
+    "    uint total_cycles_lo[MAX_SECTIONS];\n"
+    "    uint total_cycles_hi[MAX_SECTIONS];\n"
+    "};\n"
+    "uniform int  iprofile_section = -1; // Section shown as a heatmap, -1 for none.\n"
+    "uniform uint iprofile_scale = 1u;\n"
+    "uint section_evaluations[MAX_SECTIONS] = uint[MAX_SECTIONS](" + zeros + ");\n"
+    "uint section_cycles[MAX_SECTIONS] = uint[MAX_SECTIONS](" + zeros + ");\n"
+    "uint profileBegin() {\n"
+    "#ifdef PROFILE_CLOCK\n"
+    "    return clock2x32ARB().x;\n"
+    "#else\n"
+    "    return 0u;\n"
+    "#endif\n"
+    "}\n"
+    "void profileEnd(int section, uint start) {\n"
+    "    section_evaluations[section] += 1u;\n"
+    "#ifdef PROFILE_CLOCK\n"
+    "    section_cycles[section] += clock2x32ARB().x - start;\n"
+    "#endif\n"
+    "}\n"
+    "void profileFlush() {\n"
+    "    for (int i = 0; i < MAX_SECTIONS; i++) {\n"
+    "        if (section_evaluations[i] == 0u) continue;\n"
+    "        atomicAdd(total_evaluations[i], section_evaluations[i]);\n"
+    "        uint old = atomicAdd(total_cycles_lo[i], section_cycles[i]);\n"
+    "        if (old + section_cycles[i] < old) atomicAdd(total_cycles_hi[i], 1u);\n"
+    "    }\n"
+    "}\n"
+    "uint profileHeatmap(uint fallback) {\n"
+    "    if (iprofile_section < 0) return fallback;\n"
+    "#ifdef PROFILE_CLOCK\n"
+    "    uint cost = section_cycles[iprofile_section];\n"
+    "#else\n"
+    "    uint cost = section_evaluations[iprofile_section];\n"
+    "#endif\n"
+    "    return min(cost / iprofile_scale, 65535u);\n"
+    "}\n";
+
+  return Shader{.path = PROFILE_SHADER_PATH, .type = GL_FRAGMENT_SHADER, .source = source};
+}
+
+ShaderProgram SectionProfiler::profile(ShaderProgram program) {
+  program.name += "-profile";
+  program.id = 0;
+  for (auto &shader : program.shaders) shader.id = 0;
+  program.shaders.push_back(profileShader());
+  program.transform = [this](const Shader &shader, const std::string &source) {
+    return instrument(shader, source);
+  };
+  return program;
+}
+
+void SectionProfiler::beginFrame(int pixel_count) {
+  poll();
+
+  Readback &readback = readbacks[head];
+  bound_overflow = readback.fence != nullptr;  // Ring is full, discard this frame.
+  GLuint ssbo = bound_overflow ? overflow_ssbo : readback.ssbo;
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
+  readback.pixel_count = std::max(pixel_count, 1);
+}
+
+void SectionProfiler::endFrame() {
+  if (bound_overflow) return;
+
+  readbacks[head].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  head = (head + 1) % RING_SIZE;
+}
+
+bool SectionProfiler::poll() {
+  bool updated = false;
+  GLuint totals[3 * MAX_SECTIONS];
+
+  while (readbacks[tail].fence) {
+    Readback &readback = readbacks[tail];
+    GLenum status = glClientWaitSync(readback.fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    tail = (tail + 1) % RING_SIZE;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, readback.ssbo);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(totals), totals);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (size_t i = 0; i < costs.size(); i++) {
+      unsigned long long cycles = ((unsigned long long)totals[2 * MAX_SECTIONS + i] << 32) | totals[MAX_SECTIONS + i];
+      costs[i].evaluations = (double)totals[i] / readback.pixel_count;
+      costs[i].cycles = (double)cycles / readback.pixel_count;
+    }
+    updated = true;
+  }
+
+  return updated;
+}
+
+GLuint SectionProfiler::heatmapScale(int section) const {
+  if (section < 0 || section >= (int)costs.size()) return 1;
+
+  // Map the average pixel to a quarter of the iterations colour range.
+  double mean = clock ? costs[section].cycles : costs[section].evaluations;
+  return std::max((GLuint)(mean / 32.0), (GLuint)1);
+}
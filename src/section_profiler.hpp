@@ -0,0 +1,70 @@
+#ifndef CSCI_4110U_SECTION_PROFILER_H
+#define CSCI_4110U_SECTION_PROFILER_H
+
+#include <string>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "shader_manager.hpp"
+
+struct SectionCost {
+  std::string name;
+  double evaluations = 0.0;  // Per pixel.
+  double cycles = 0.0;       // Per pixel, 0 without ARB_shader_clock.
+};
+
+/* Profiling builds of the scene shaders.
+
+   Every `//===== Section: X =====//` block in a profiled program is wrapped
+   in calls that count its evaluations and, with ARB_shader_clock, the shader
+   clock cycles spent inside it. Sections inside a function body are
+   instrumented in place, sections around a whole function wrap that
+   function. Costs are inclusive: a section calling an instrumented function
+   also pays for it.
+
+   Each fragment sums its costs locally and adds them to an SSBO once at the
+   end of main(). The SSBOs are read back through a fenced ring the same way
+   as IterationStats. Requires GL 4.3 (SSBOs and atomics).
+*/
+class SectionProfiler {
+  static constexpr int MAX_SECTIONS = 32;
+  static constexpr int RING_SIZE = 3;
+
+  struct Readback {
+    GLuint ssbo = 0;
+    GLsync fence = nullptr;
+    int pixel_count = 1;
+  };
+
+  bool clock = false;
+  std::vector<std::string> names{};  // Index is the section id in the shaders.
+  Readback readbacks[RING_SIZE];
+  GLuint overflow_ssbo = 0;          // Written when every readback is in flight.
+  int head = 0;
+  int tail = 0;
+  bool bound_overflow = false;
+  std::vector<SectionCost> costs{};
+
+  int sectionId(const std::string &name);
+
+  public:
+    SectionProfiler();
+    ~SectionProfiler();
+
+    static bool supported();
+
+    std::string instrument(const Shader &shader, const std::string &source);
+    Shader profileShader() const;
+    ShaderProgram profile(ShaderProgram program);
+
+    void beginFrame(int pixel_count);
+    void endFrame();
+    bool poll();
+
+    bool hasClock() const { return clock; }
+    const std::vector<SectionCost> &latest() const { return costs; }
+    GLuint heatmapScale(int section) const;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "bench.hpp"
+#include "shader_bench.hpp"
+
+static double nowMs() {
+  auto time = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+static const char *stageName(GLenum type) {
+  switch (type) {
+    case GL_VERTEX_SHADER: return "vertex";
+    case GL_FRAGMENT_SHADER: return "fragment";
+    case GL_GEOMETRY_SHADER: return "geometry";
+    case GL_COMPUTE_SHADER: return "compute";
+    default: return "other";
+  }
+}
+
+static std::string infoLog(GLuint id, bool program) {
+  GLint length = 0;
+  program ? glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length) : glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+  std::string log(length, '\0');
+  program ? glGetProgramInfoLog(id, length, nullptr, log.data()) : glGetShaderInfoLog(id, length, nullptr, log.data());
+  return log;
+}
+
+void ShaderBench::measure(ShaderManager &shader_manager, const std::string &key, const ShaderDefines &defines) {
+  auto &desc = shader_manager.getProgram(key);
+  auto sources = shader_manager.sources(key, defines);
+
+  ShaderBenchProgram program{.name = ShaderManager::permutationName(key, defines), .defines = defines};
+  for (auto &shader : desc.shaders) program.shaders.push_back({.path = shader.path, .type = (GLenum)shader.type});
+
+  // Differs between processes too, in case a disk cache is still on.
+  auto nonce = std::chrono::steady_clock::now().time_since_epoch().count();
+  for (int run = 0; run < runs && program.compiled; run++) {
+    std::string tag = "\n// shader-bench " + std::to_string(nonce) + " " + std::to_string(run) + "\n";
+    std::vector<GLuint> shaders;
+    double total = 0.0;
+
+    for (size_t i = 0; i < sources.size() && program.compiled; i++) {
+      std::string source = sources[i] + tag;
+      const char *source_str = source.c_str();
+      GLuint shader = glCreateShader(desc.shaders[i].type);
+      glShaderSource(shader, 1, &source_str, NULL);
+      shaders.push_back(shader);
+
+      GLint status = GL_FALSE;
+      double start = nowMs();
+      glCompileShader(shader);
+      glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+      double compile_ms = nowMs() - start;
+
+      program.shaders[i].compile_ms.push_back(compile_ms);
+      total += compile_ms;
+      if (status == GL_FALSE) {
+        spdlog::error("Shader bench: {} {} {}", program.name, desc.shaders[i].path, infoLog(shader, false));
+        program.compiled = false;
+      }
+    }
+
+    GLuint id = glCreateProgram();
+    if (program.compiled) {
+      for (auto shader : shaders) glAttachShader(id, shader);
+
+      GLint status = GL_FALSE;
+      double start = nowMs();
+      glLinkProgram(id);
+      glGetProgramiv(id, GL_LINK_STATUS, &status);
+      double link_ms = nowMs() - start;
+
+      program.link_ms.push_back(link_ms);
+      program.total_ms.push_back(total + link_ms);
+      if (status == GL_FALSE) {
+        spdlog::error("Shader bench: {} {}", program.name, infoLog(id, true));
+        program.compiled = false;
+      }
+    }
+
+    glDeleteProgram(id);
+    for (auto shader : shaders) glDeleteShader(shader);
+  }
+
+  if (program.compiled) {
+    auto total = FrameTimeStats::from(program.total_ms);
+    spdlog::info("Shader bench: {} {:.2f}ms median ({:.2f}ms link)",
+      program.name, total.median, FrameTimeStats::from(program.link_ms).median);
+  }
+  programs.push_back(program);
+}
+
+void ShaderBench::writeReport(const std::string &renderer) const {
+  std::ofstream out{output};
+  if (!out) {
+    spdlog::error("Shader bench: Could not open {} for writing!", output);
+    return;
+  }
+
+  out << "{\n"
+      << "  \"renderer\": \"" << renderer << "\",\n"
+      << "  \"runs\": " << runs << ",\n"
+      << "  \"programs\": [";
+  for (size_t i = 0; i < programs.size(); i++) {
+    auto &program = programs[i];
+    out << (i == 0 ? "\n" : ",\n")
+        << "    {\n"
+        << "      \"name\": \"" << program.name << "\",\n"
+        << "      \"defines\": {";
+    for (auto define = program.defines.begin(); define != program.defines.end(); define++) {
+      out << (define == program.defines.begin() ? "" : ", ") << "\"" << define->first << "\": \"" << define->second << "\"";
+    }
+    out << "},\n"
+        << "      \"compiled\": " << (program.compiled ? "true" : "false") << ",\n"
+        << "      \"shaders\": [";
+    for (size_t j = 0; j < program.shaders.size(); j++) {
+      auto &shader = program.shaders[j];
+      out << (j == 0 ? "\n" : ",\n")
+          << "        {\"path\": \"" << shader.path << "\", \"stage\": \"" << stageName(shader.type) << "\", ";
+      writeStats(out, "compile_ms", FrameTimeStats::from(shader.compile_ms), "");
+      out << "}";
+    }
+    out << "\n      ],\n";
+    writeStats(out, "link_ms", FrameTimeStats::from(program.link_ms), "      ");
+    out << ",\n";
+    writeStats(out, "total_ms", FrameTimeStats::from(program.total_ms), "      ");
+    out << "\n    }";
+  }
+  out << "\n  ]\n}\n";
+
+  spdlog::info("Shader bench: {} programs, {} runs each -> {}", programs.size(), runs, output);
+}
@@ -0,0 +1,48 @@
+#ifndef CSCI_4110U_SHADER_BENCH_H
+#define CSCI_4110U_SHADER_BENCH_H
+
+#include <string>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "shader_manager.hpp"
+
+struct ShaderBenchShader {
+  std::string path;
+  GLenum type;
+  std::vector<double> compile_ms{};
+};
+
+struct ShaderBenchProgram {
+  std::string name;  // Permutation name, see ShaderManager::permutationName.
+  ShaderDefines defines{};
+  bool compiled = true;
+  std::vector<ShaderBenchShader> shaders{};
+  std::vector<double> link_ms{};
+  std::vector<double> total_ms{};  // Every compile and the link.
+};
+
+/* Compile and link times of each program and permutation, from source.
+
+   Every run compiles fresh shader objects from the program's final sources
+   and waits for the status of each step, so the time of a step is the time
+   until the driver has finished it. A comment unique to the run is appended
+   to every source, which misses any cache keyed on the source (main also
+   disables Mesa's and NVIDIA's disk caches); ShaderManager's program cache
+   is not used. Many drivers defer most of the work to the link, compare
+   totals between drivers rather than stages.
+*/
+class ShaderBench {
+  int runs;
+  std::string output;
+  std::vector<ShaderBenchProgram> programs{};
+
+  public:
+    ShaderBench(int runs, const std::string &output) : runs(runs), output(output) {}
+
+    void measure(ShaderManager &shader_manager, const std::string &key, const ShaderDefines &defines = {});
+    void writeReport(const std::string &renderer) const;
+};
+
+#endif
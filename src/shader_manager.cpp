@@ -1,13 +1,30 @@
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <regex>
 #include <sstream>
 
-#include <FileWatch.hpp>
 #include <spdlog/spdlog.h>
 
+#ifdef CSCI_4110U_EMBED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
+#include "gl_extensions.hpp"
 #include "shader_manager.hpp"
+#include "startup.hpp"
+#include "trace.hpp"
 
 
 std::string ShaderManager::slurp(const std::string &path) const {
+  StartupScope startup{STARTUP_READ};
+#ifdef CSCI_4110U_EMBED_SHADERS
+  auto normal = ShaderWatcher::normalise(path);
+  for (auto &shader : embedded_shaders) {
+    if (shader.path == normal) return std::string(shader.source);
+  }
+  spdlog::error("{} is not an embedded shader!", path);
+  return "";
+#else
   std::ifstream file{path};
   std::ostringstream str_stream;
   std::string source;
@@ -16,103 +33,452 @@ std::string ShaderManager::slurp(const std::string &path) const {
   source = str_stream.str();
 
   return source;
+#endif
+}
+
+bool ShaderManager::exists(const std::string &path) const {
+#ifdef CSCI_4110U_EMBED_SHADERS
+  auto normal = ShaderWatcher::normalise(path);
+  for (auto &shader : embedded_shaders) {
+    if (shader.path == normal) return true;
+  }
+  return false;
+#else
+  std::error_code error;
+  return std::filesystem::is_regular_file(path, error);
+#endif
+}
+
+// Expands the includes of one file, appending it and everything it includes
+// to `files`; its index there is its #line source string number.
+std::string ShaderManager::preprocess(const std::string &path, const std::string &source, std::vector<std::string> &files) {
+  static const std::regex directive{R"re(^\s*#\s*include\s+"([^"]+)")re"};
+
+  int number = files.size();
+  files.push_back(path);
+  auto &included = includes[path];
+  included.clear();
+
+  std::istringstream stream{source};
+  std::string result;
+  std::string line;
+  std::smatch match;
+  for (int line_number = 1; std::getline(stream, line); line_number++) {
+    if (!std::regex_search(line, match, directive)) {
+      result += line + "\n";
+      continue;
+    }
+
+    auto include = ShaderWatcher::normalise((std::filesystem::path(path).parent_path() / match[1].str()).string());
+    if (!exists(include)) include = ShaderWatcher::normalise(SHADER_DIR "/" + match[1].str());
+    if (!exists(include)) {
+      spdlog::error("{}:{}: Can not find {}", path, line_number, match[1].str());
+      result += line + "\n";  // Fails the compile.
+      continue;
+    }
+    included.insert(include);
+    if (std::find(files.begin(), files.end(), include) != files.end()) {
+      result += "\n";  // Already included.
+      continue;
+    }
+
+    result += "#line 1 " + std::to_string(files.size()) + "\n";
+    result += preprocess(include, slurp(include), files);
+    result += "#line " + std::to_string(line_number + 1) + " " + std::to_string(number) + "\n";
+  }
+  return result;
+}
+
+// The file and every file including it, directly or not.
+std::set<std::string> ShaderManager::includers(const std::string &path) const {
+  std::set<std::string> found{path};
+  std::vector<std::string> pending{path};
+  while (!pending.empty()) {
+    auto file = pending.back();
+    pending.pop_back();
+    for (auto &[includer, included] : includes) {
+      if (included.count(file) && found.insert(includer).second) pending.push_back(includer);
+    }
+  }
+  return found;
 }
 
 GLuint ShaderManager::get(const std::string &key) const {
   return programs.at(key).id;
 }
 
-void ShaderManager::compileShader(Shader &shader) {
-  std::string source_str = slurp(shader.path);
-  const char *source = source_str.c_str();
-  GLuint shader_id = 0;
+static std::string injectDefines(const std::string &source, const ShaderDefines &defines) {
+  bool used = false;
+  for (auto &[name, value] : defines) used = used || source.find(name) != std::string::npos;
+  if (!used) return source;
+
+  // After the #version line, which has to come first.
+  size_t at = 0;
+  size_t version = source.find("#version");
+  if (version != std::string::npos) at = std::min(source.find('\n', version), source.size() - 1) + 1;
+  int line = std::count(source.begin(), source.begin() + at, '\n') + 1;
+
+  std::string block;
+  for (auto &[name, value] : defines) block += "#define " + name + " " + value + "\n";
+  block += "#line " + std::to_string(line) + "\n";  // Errors keep the file's line numbers.
+  return source.substr(0, at) + block + source.substr(at);
+}
+
+std::string ShaderManager::permutationName(const std::string &key, const ShaderDefines &defines) {
+  std::string name = key;
+  for (auto &[define, value] : defines) name += (name.size() == key.size() ? "#" : ",") + define + "=" + value;
+  return name;
+}
+
+GLuint ShaderManager::get(const std::string &key, const ShaderDefines &defines, bool wait) {
+  std::string name = permutationName(key, defines);
+
+  if (programs.find(name) == programs.end()) {
+    ShaderProgram permutation = programs.at(key);
+    permutation.name = name;
+    permutation.transform = [transform = permutation.transform, defines](const Shader &shader, const std::string &source) {
+      return injectDefines(transform ? transform(shader, source) : source, defines);
+    };
+
+    bool watched = false;
+    for (auto &[path, names] : dependents) watched = watched || names.count(key) > 0;
+    store(permutation);
+    if (watched) watch(permutation);
+    lazy.insert(name);
+  }
+
+  request(name, wait);
+  return programs.at(name).id;
+}
+
+// Starts the build of a program that was never compiled, and with `wait`
+// finishes it (or the build already in flight) before returning.
+void ShaderManager::request(const std::string &name, bool wait) {
+  if (lazy.erase(name)) {
+    TraceScope scope{"Request " + name};
+    ProgramBuild build;
+    if (!startBuild(programs.at(name), build)) builds.push_back(build);
+  }
+  if (!wait) return;
+
+  for (auto build = builds.begin(); build != builds.end(); build++) {
+    if (build->name != name) continue;
+    finishBuild(programs.at(name), *build);
+    builds.erase(build);
+    return;
+  }
+}
+
+const ShaderProgram &ShaderManager::getProgram(const std::string &key) const {
+  return programs.at(key);
+}
+
+std::vector<std::string> ShaderManager::sources(const std::string &key, const ShaderDefines &defines) {
+  auto &program = programs.at(key);
+  std::vector<std::string> sources;
+  for (auto &shader : program.shaders) sources.push_back(injectDefines(shaderSource(shader, program.transform), defines));
+  return sources;
+}
+
+std::string ShaderManager::shaderSource(const Shader &shader, const ShaderTransform &transform, std::vector<std::string> *files) {
+  std::vector<std::string> own_files;
+  std::string source = shader.source.empty() ? slurp(shader.path) : shader.source;
+  source = preprocess(ShaderWatcher::normalise(shader.path), source, files ? *files : own_files);
+  if (transform) source = transform(shader, source);
+  return source;
+}
+
+void ShaderManager::bindUniformBlock(const std::string &block, GLuint binding) {
+  uniform_blocks[block] = binding;
+  for (auto &[name, program] : programs) reflect(program);
+}
+
+// Caches the program's uniform locations and binds its uniform blocks, after
+// every link or binary load.
+void ShaderManager::reflect(ShaderProgram &program) const {
+  program.uniforms.clear();
+  if (program.id == 0) return;
+
+  GLint count = 0;
+  GLint max_length = 0;
+  glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::string name(max_length, '\0');
+  for (GLint i = 0; i < count; i++) {
+    GLsizei length = 0;
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(program.id, i, max_length, &length, &size, &type, name.data());
+
+    std::string uniform = name.substr(0, length);
+    GLint location = glGetUniformLocation(program.id, uniform.c_str());
+    if (location < 0) continue;  // Block member.
+    if (uniform.ends_with("[0]")) uniform.resize(uniform.size() - 3);
+    program.uniforms[uniform] = location;
+  }
+
+  for (auto &[block, binding] : uniform_blocks) {
+    GLuint index = glGetUniformBlockIndex(program.id, block.c_str());
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(program.id, index, binding);
+  }
+}
+
+ShaderManager::ShaderManager() {
+  parallel_compile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+  spdlog::info("Shader reloads: {}", parallel_compile ? "parallel compile (KHR_parallel_shader_compile)" : "finished one frame later");
+}
+
+// Drivers report locations as <source string>:<line>, e.g. Mesa's
+// "2:14(5): error", name the file instead.
+static std::string nameFiles(const std::string &log, const std::vector<std::string> &files) {
+  static const std::regex location{R"((^|\n)(ERROR: |WARNING: )?(\d+)[:(]\d+)"};
+
+  std::string result;
+  auto last = log.cbegin();
+  for (std::sregex_iterator match{log.begin(), log.end(), location}, end; match != end; match++) {
+    auto &number = (*match)[3];
+    size_t index = std::stoul(number.str());
+    result.append(last, number.first);
+    result += index < files.size() ? files[index] : number.str();
+    last = number.second;
+  }
+  result.append(last, log.cend());
+  return result;
+}
+
+static void logShaderErrors(GLuint shader_id, const std::vector<std::string> &files) {
   GLint shader_param;
+  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &shader_param);
+  if (shader_param == GL_TRUE) return;
+
+  auto logger = spdlog::get("logger");
+  std::string shader_log;
+  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &shader_param);
 
+  shader_log.resize(shader_param);
+  glGetShaderInfoLog(shader_id, shader_param, nullptr, shader_log.data());
+  spdlog::error("  {} {}", files[0], nameFiles(shader_log, files));
+  logger->flush();
+}
+
+// Compiles the shader unless an identical one is already shared.
+GLuint ShaderManager::acquireShader(const Shader &shader, const std::string &source, uint64_t &key) {
+  key = ProgramCache::add(ProgramCache::add(ProgramCache::add(cache.begin(), shader.path), std::to_string(shader.type)), source);
+
+  auto &object = shader_objects[key];
+  if (object.refs++ > 0) return object.id;
+
+  const char *source_str = source.c_str();
   spdlog::info("  Compiling {}", shader.path.c_str());
-  shader_id = glCreateShader(shader.type);
-  glShaderSource(shader_id, 1, &source, NULL);
-  glCompileShader(shader_id);
+  object.id = glCreateShader(shader.type);
+  glShaderSource(object.id, 1, &source_str, NULL);
+  StartupScope startup{STARTUP_COMPILE};
+  glCompileShader(object.id);
+  return object.id;
+}
 
-  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &shader_param);
-  if (shader_param == GL_FALSE) {
-    auto logger = spdlog::get("logger");
-    std::string shader_log;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &shader_param);
+void ShaderManager::releaseShader(uint64_t key) {
+  auto object = shader_objects.find(key);
+  if (object == shader_objects.end() || --object->second.refs > 0) return;
 
-    shader_log.resize(shader_param);
-    glGetShaderInfoLog(shader_id, shader_param, nullptr, shader_log.data());
-    spdlog::error("  {} {}", shader.path.c_str(), shader_log);
-    logger->flush();
-  } else {
-    // _Flag_ shader for deletion.
-    glDeleteShader(shader.id);
-    shader.id = shader_id;
-  }
+  // _Flag_ shader for deletion, freed with the last program using it.
+  glDeleteShader(object->second.id);
+  shader_objects.erase(object);
 }
 
-void ShaderManager::compileProgram(ShaderProgram &program) {
-  GLuint program_id = 0;
-  GLint program_param;
+void ShaderManager::discardBuild(ProgramBuild &build) {
+  glDeleteProgram(build.id);
+  for (auto key : build.shader_keys) releaseShader(key);
+}
 
-  spdlog::info("Compiling {} shaders:", program.name.c_str());
-  program_id = glCreateProgram();
+// Issues the compile and link without asking for the result, which lets the
+// driver work on it in the background. Returns true when the program was
+// found in the cache instead.
+bool ShaderManager::startBuild(ShaderProgram &program, ProgramBuild &build) {
+  TraceScope scope{"Compile " + program.name};
 
-  for(auto &shader : program.shaders) {
-    compileShader(shader);
-    glAttachShader(program_id, shader.id);
+  // The final sources are the cache key.
+  std::vector<std::string> sources;
+  build = {.name = program.name, .key = cache.begin(), .frame = frame};
+  for (auto &shader : program.shaders) {
+    build.files.emplace_back();
+    sources.push_back(shaderSource(shader, program.transform, &build.files.back()));
+    build.key = ProgramCache::add(build.key, std::to_string(shader.type));
+    build.key = ProgramCache::add(build.key, sources.back());
   }
 
-  glLinkProgram(program_id);
+  GLuint cached;
+  {
+    StartupScope startup{STARTUP_BINARY};
+    cached = cache.load(build.key);
+  }
+  if (cached) {
+    spdlog::info("Loaded {} from the program cache", program.name.c_str());
+    glDeleteProgram(program.id);
+    program.id = cached;
+    for (auto &shader : program.shaders) {
+      releaseShader(shader.key);
+      shader.id = 0;
+      shader.key = 0;
+    }
+    reflect(program);
+    return true;
+  }
+
+  spdlog::info("Compiling {} shaders:", program.name.c_str());
+  build.id = glCreateProgram();
+  for (size_t i = 0; i < program.shaders.size(); i++) {
+    uint64_t shader_key;
+    GLuint shader_id = acquireShader(program.shaders[i], sources[i], shader_key);
+    glAttachShader(build.id, shader_id);
+    build.shaders.push_back(shader_id);
+    build.shader_keys.push_back(shader_key);
+  }
+
+  if (cache.active()) glProgramParameteri(build.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  StartupScope startup{STARTUP_LINK};
+  glLinkProgram(build.id);
+  return false;
+}
+
+// Without parallel compiles the status query blocks until the link is done,
+// so it is only deferred to the frame after the build started.
+bool ShaderManager::buildReady(const ProgramBuild &build) const {
+  if (!parallel_compile) return build.frame != frame;
+
+  GLint done = GL_FALSE;
+  glGetProgramiv(build.id, GL_COMPLETION_STATUS_KHR, &done);
+  return done == GL_TRUE;
+}
+
+// Swaps the new program in if it linked, otherwise keeps the old one.
+void ShaderManager::finishBuild(ShaderProgram &program, ProgramBuild &build) {
+  GLint program_param;
 
-  glGetProgramiv(program_id, GL_LINK_STATUS, &program_param);
+  {
+    StartupScope startup{STARTUP_LINK};  // Waits for the driver without parallel compiles.
+    glGetProgramiv(build.id, GL_LINK_STATUS, &program_param);
+  }
   if (program_param == GL_FALSE) {
+    for (size_t i = 0; i < build.shaders.size(); i++) {
+      logShaderErrors(build.shaders[i], build.files[i]);
+    }
+
     auto logger = spdlog::get("logger");
     std::string program_log;
-    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &program_param);
+    glGetProgramiv(build.id, GL_INFO_LOG_LENGTH, &program_param);
 
     program_log.resize(program_param);
-    glGetProgramInfoLog(program_id, program_param, nullptr, program_log.data());
+    glGetProgramInfoLog(build.id, program_param, nullptr, program_log.data());
     spdlog::error("{} {}", program.name.c_str(), program_log);
     logger->flush();
-  } else {
-    glDeleteProgram(program.id);
-    program.id = program_id;
+
+    discardBuild(build);
+    return;
   }
+
+  glDeleteProgram(program.id);
+  program.id = build.id;
+  for (size_t i = 0; i < build.shaders.size(); i++) {
+    releaseShader(program.shaders[i].key);
+    program.shaders[i].id = build.shaders[i];
+    program.shaders[i].key = build.shader_keys[i];
+  }
+  reflect(program);
+  cache.store(build.key, build.id);
 }
 
-// TODO: FileWatcher runs twice per modification.
-void ShaderManager::compileAndWatch(ShaderProgram program_desc) {
-  // Store copy of `program_desc` first, then grab _reference_ to stored copy.
+void ShaderManager::compileProgram(ShaderProgram &program) {
+  ProgramBuild build;
+  if (startBuild(program, build)) return;
+  finishBuild(program, build);
+}
+
+void ShaderManager::compile(ShaderProgram program_desc) {
+  store(program_desc);
+  compileProgram(programs.at(program_desc.name));
+}
+
+// Copies of other programs must not release the objects they were copied with.
+void ShaderManager::store(ShaderProgram program_desc) {
+  program_desc.id = 0;
+  program_desc.uniforms.clear();
+  for (auto &shader : program_desc.shaders) {
+    shader.id = 0;
+    shader.key = 0;
+  }
+  auto replaced = programs.find(program_desc.name);
+  if (replaced != programs.end()) {
+    for (auto &shader : replaced->second.shaders) releaseShader(shader.key);
+    glDeleteProgram(replaced->second.id);
+  }
+  lazy.erase(program_desc.name);
   programs[program_desc.name] = program_desc;
-  ShaderProgram &program = programs.at(program_desc.name);
+}
 
-  compileProgram(program);
+void ShaderManager::compileAndWatch(ShaderProgram program_desc) {
+  compile(program_desc);
+  watch(program_desc);
+}
 
-  for (auto &shader : program.shaders) {
-     auto watcher = new filewatch::FileWatch<std::string>(
-      shader.path,
-      [this, &program](const std::string &path, const filewatch::Event ev){
-        if (ev != filewatch::Event::modified) return;
-
-        mutex.lock();
-        out_of_date_programs.push(program.name);
-        mutex.unlock();
-      }
-    );
-    watchers.push_back(watcher);
+void ShaderManager::addAndWatch(ShaderProgram program_desc) {
+  store(program_desc);
+  watch(program_desc);
+  lazy.insert(program_desc.name);
+}
+
+void ShaderManager::watch([[maybe_unused]] const ShaderProgram &program_desc) {
+#ifdef CSCI_4110U_EMBED_SHADERS
+  // Built in, nothing to reload.
+#else
+  watcher.start(SHADER_DIR);
+
+  for (auto &shader : program_desc.shaders) {
+    if (!shader.source.empty()) continue;  // Nothing to watch.
+
+    auto path = ShaderWatcher::normalise(shader.path);
+    if (path.rfind(SHADER_DIR "/", 0) != 0) spdlog::warn("{} is outside of " SHADER_DIR "/ and not watched", path);
+    dependents[path].insert(program_desc.name);
   }
+#endif
 }
 
+// New programs are swapped in between frames once the driver reports them
+// complete, until then the old program keeps drawing.
 void ShaderManager::recompilePending() {
-  if (!mutex.try_lock()) return;
+  frame++;
+  std::set<std::string> out_of_date;
+  std::string path;
+  while (watcher.poll(path)) {
+    for (auto &file : includers(path)) {
+      auto found = dependents.find(file);
+      if (found != dependents.end()) out_of_date.insert(found->second.begin(), found->second.end());
+    }
+  }
 
-  if (out_of_date_programs.size() > 0) {
-    std::string &program_name = out_of_date_programs.front();
-    ShaderProgram &program = programs.at(program_name);
-    out_of_date_programs.pop();
+  for (auto &name : out_of_date) {
+    if (lazy.count(name)) continue;  // Compiled with the new source when first requested.
 
-    compileProgram(program);
+    // A newer save replaces a build still in progress.
+    for (auto build = builds.begin(); build != builds.end(); ) {
+      if (build->name != name) {
+        build++;
+        continue;
+      }
+      discardBuild(*build);
+      build = builds.erase(build);
+    }
+
+    ProgramBuild build;
+    if (!startBuild(programs.at(name), build)) builds.push_back(build);
   }
 
-  mutex.unlock();
+  for (auto build = builds.begin(); build != builds.end(); ) {
+    if (!buildReady(*build)) {
+      build++;
+      continue;
+    }
+    finishBuild(programs.at(build->name), *build);
+    build = builds.erase(build);
+  }
 }
@@ -1,52 +1,129 @@
 #ifndef CSCI_4110U_SHADER_MANAGER_H
 #define CSCI_4110U_SHADER_MANAGER_H
 
+#include <functional>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
-#include <queue>
-#include <mutex>
 
-#include <FileWatch.hpp>
 #include <GL/gl.h>
 
-/* It is assumed that there is a _one-to-one_ correspondence between shader
-   files, shader objects, and shader programs. ShaderManager will not work
-   with shaders that belong to multiple programs or shader objects made from
-   multiple files.
+#include "program_cache.hpp"
+#include "shader_watcher.hpp"
+
+#define SHADER_DIR "shaders"  // Watched for changes by compileAndWatch.
+
+/* Shader objects are shared between programs. Each is keyed by its path,
+   stage and final source (after transforms) and reference counted by the
+   programs and builds using it, so a file used by several programs is
+   compiled once and a change to it compiles it once for all of them.
+   Programs whose sources did not change are not relinked.
+
+   `#include "file.glsl"` is expanded before anything else sees the source,
+   relative to the including file or else to SHADER_DIR, and each file only
+   once per shader. Included files are numbered in #line directives and the
+   numbers replaced with paths in compile errors. A change to a file rebuilds
+   the programs that include it, directly or through other includes.
 */
 
 struct Shader {
   std::string path;
   GLint type = GL_VERTEX_SHADER;
   GLuint id = 0;
+  uint64_t key = 0;      // Shared shader object in use, see ShaderManager.
+  std::string source{};  // Generated source, used instead of `path` when set.
 };
 
+// Rewrites a shader's source before it is compiled (e.g. profiling builds).
+using ShaderTransform = std::function<std::string(const Shader &shader, const std::string &source)>;
+
+/* Permutation of a program: #define name -> value, injected after #version
+   into each of its shaders that mentions one of the names (others keep
+   sharing the default shader object). Shaders provide defaults with #ifndef.
+*/
+using ShaderDefines = std::map<std::string, std::string>;
+
 struct ShaderProgram {
   std::string name;
   std::vector<Shader> shaders{};
   GLuint id = 0;
+  ShaderTransform transform{};
+  std::map<std::string, GLint> uniforms{};  // Active uniforms outside of blocks, read on link.
+
+  GLint uniform(const std::string &name) const {  // -1 if inactive, like glGetUniformLocation.
+    auto found = uniforms.find(name);
+    return found == uniforms.end() ? -1 : found->second;
+  }
 };
 
+// Not defined without the extension in glad.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 struct ShaderManager {
+  ShaderManager();
+
   GLuint get(const std::string &key) const;
+  // Compiles the program or permutation in the background on first use,
+  // 0 until it has linked unless `wait`.
+  GLuint get(const std::string &key, const ShaderDefines &defines, bool wait = false);
+  const ShaderProgram &getProgram(const std::string &key) const;
+  // Sources of the program's shaders (or of a permutation) as they are compiled.
+  std::vector<std::string> sources(const std::string &key, const ShaderDefines &defines = {});
+  static std::string permutationName(const std::string &key, const ShaderDefines &defines);  // e.g. "gundam#EPS=0.002".
+  void compile(ShaderProgram program_desc);  // Not reloaded on changes.
   void compileAndWatch(ShaderProgram program_desc);
-  void recompilePending();
-
-  ~ShaderManager() {
-    for (auto watcher : watchers) {
-      delete watcher;
-    }
-  }
+  void addAndWatch(ShaderProgram program_desc);  // Not compiled until requested with get(key, defines).
+  void recompilePending();  // Does not wait for the driver.
+  std::string slurp(const std::string &path) const;
+  void useCache(const std::string &dir) { cache.open(dir); }  // Program binaries, empty for none.
+  void bindUniformBlock(const std::string &block, GLuint binding);  // In every program that has it.
 
   private:
     std::map<std::string, ShaderProgram> programs{};
-    std::vector<filewatch::FileWatch<std::string>*> watchers;
-    std::queue<std::string> out_of_date_programs{};
-    std::mutex mutex;
+    std::map<std::string, std::set<std::string>> dependents{};  // Watched path -> program names.
+    std::map<std::string, std::set<std::string>> includes{};    // Path -> paths it includes, as last read.
+    ShaderWatcher watcher{};
+    std::map<std::string, GLuint> uniform_blocks{};
+    std::set<std::string> lazy{};  // Never requested, not compiled.
+    ProgramCache cache;
+
+    // A program being compiled and linked, not in use yet.
+    struct ProgramBuild {
+      std::string name;
+      GLuint id = 0;
+      std::vector<GLuint> shaders{};
+      std::vector<uint64_t> shader_keys{};
+      std::vector<std::vector<std::string>> files{};  // Per shader, by #line source string number.
+      uint64_t key = 0;
+      uint64_t frame = 0;  // recompilePending() calls before it was started.
+    };
+    std::vector<ProgramBuild> builds{};
+    uint64_t frame = 0;
+
+    struct ShaderObject {
+      GLuint id = 0;
+      int refs = 0;
+    };
+    std::map<uint64_t, ShaderObject> shader_objects{};
+    bool parallel_compile = false;
 
-    std::string slurp(const std::string &path) const;
-    void compileShader(Shader &shader);
+    bool exists(const std::string &path) const;
+    std::string preprocess(const std::string &path, const std::string &source, std::vector<std::string> &files);
+    std::set<std::string> includers(const std::string &path) const;
+    std::string shaderSource(const Shader &shader, const ShaderTransform &transform, std::vector<std::string> *files = nullptr);
+    GLuint acquireShader(const Shader &shader, const std::string &source, uint64_t &key);
+    void releaseShader(uint64_t key);
+    void discardBuild(ProgramBuild &build);
+    bool startBuild(ShaderProgram &program, ProgramBuild &build);
+    bool buildReady(const ProgramBuild &build) const;
+    void finishBuild(ShaderProgram &program, ProgramBuild &build);
+    void store(ShaderProgram program_desc);
+    void watch(const ShaderProgram &program_desc);
+    void request(const std::string &name, bool wait);
+    void reflect(ShaderProgram &program) const;
     void compileProgram(ShaderProgram &program);
 };
 
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <regex>
+#include <sstream>
+
+#include "shader_sections.hpp"
+
+static const std::regex section_marker{R"(//=+ Section(?: End)?: ([a-zA-Z_\-0-9]+) =+//)"};
+static const std::regex function_header{R"((\w+)\s+(\w+)\s*\(([^)]*)\)\s*\{)"};
+static const std::regex identifier{R"((\w+)\s*$)"};
+
+// Strips a trailing `//` comment.
+static std::string code(const std::string &line) {
+  return line.substr(0, line.find("//"));
+}
+
+std::vector<std::string> splitLines(const std::string &source) {
+  std::vector<std::string> lines;
+  std::istringstream stream{source};
+  std::string line;
+  while (std::getline(stream, line)) lines.push_back(line);
+  return lines;
+}
+
+std::string joinLines(const std::vector<std::string> &lines) {
+  std::string source;
+  for (auto &line : lines) source += line + "\n";
+  return source;
+}
+
+std::vector<ShaderSection> findSections(const std::vector<std::string> &lines) {
+  std::vector<ShaderSection> sections;
+  ShaderSection section{};
+  bool open = false;
+  int depth = 0;
+  std::smatch match;
+
+  for (int i = 0; i < (int)lines.size(); i++) {
+    if (!std::regex_search(lines[i], match, section_marker)) {
+      auto line = code(lines[i]);
+      depth += std::count(line.begin(), line.end(), '{') - std::count(line.begin(), line.end(), '}');
+      continue;
+    }
+
+    if (!open) {
+      section = {.name = match[1], .begin_line = i, .end_line = i, .in_function = depth > 0};
+      open = true;
+      continue;
+    }
+
+    section.end_line = i;
+    open = false;
+    if (!section.in_function) {
+      for (int j = section.begin_line + 1; j < i; j++) {
+        // Headers span a single line in these shaders.
+        auto line = code(lines[j]);
+        std::smatch header;
+        if (std::regex_search(line, header, function_header)) {
+          section.return_type = header[1];
+          section.function = header[2];
+          section.params = header[3];
+          section.header_line = j;
+          break;
+        }
+      }
+    }
+    sections.push_back(section);
+  }
+
+  return sections;
+}
+
+std::string callArguments(const std::string &params) {
+  std::string args;
+  std::istringstream stream{params};
+  std::string param;
+  std::smatch match;
+  while (std::getline(stream, param, ',')) {
+    if (!std::regex_search(param, match, identifier) || match[1] == "void") continue;
+    if (!args.empty()) args += ", ";
+    args += match[1];
+  }
+  return args;
+}
+
+void renameFunction(std::vector<std::string> &lines, const ShaderSection &section, const std::string &name) {
+  if (section.header_line < 0) return;
+
+  std::regex call{"\\b" + section.function + "\\s*\\("};
+  auto &line = lines[section.header_line];
+  line = std::regex_replace(line, call, name + "(", std::regex_constants::format_first_only);
+}
@@ -0,0 +1,34 @@
+#ifndef CSCI_4110U_SHADER_SECTIONS_H
+#define CSCI_4110U_SHADER_SECTIONS_H
+
+#include <string>
+#include <vector>
+
+/* Parses the `//===== Section: X =====//` markers that delimit named blocks
+   of shader source (the same markers the report uses to quote code).
+   Markers pair up in order: open, close, open, close, ...
+*/
+
+struct ShaderSection {
+  std::string name;
+  int begin_line;      // Line of the opening marker (0 based).
+  int end_line;        // Line of the closing marker.
+  bool in_function;    // Statements inside a function body.
+
+  // Sections at file scope that contain a function definition.
+  std::string return_type{};
+  std::string function{};
+  std::string params{};
+  int header_line = -1;
+};
+
+std::vector<std::string> splitLines(const std::string &source);
+std::string joinLines(const std::vector<std::string> &lines);
+std::vector<ShaderSection> findSections(const std::vector<std::string> &lines);
+
+// "in vec3 point, in float d" -> "point, d"
+std::string callArguments(const std::string &params);
+// Renames the function defined by `section`, e.g. to wrap or replace it.
+void renameFunction(std::vector<std::string> &lines, const ShaderSection &section, const std::string &name);
+
+#endif
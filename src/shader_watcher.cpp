@@ -0,0 +1,148 @@
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "shader_watcher.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+std::string ShaderWatcher::normalise(const std::string &path) {
+  return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+void ShaderWatcher::start(const std::string &watch_root) {
+  if (running()) return;
+
+  root = normalise(watch_root);
+  stopping = false;
+  thread = std::thread(&ShaderWatcher::run, this);
+}
+
+void ShaderWatcher::stop() {
+  if (!running()) return;
+
+  stopping = true;
+  thread.join();
+}
+
+void ShaderWatcher::deliver(const std::string &path) {
+  if (!changed.push(path)) spdlog::warn("Shader watcher: Queue full, dropped {}", path);
+}
+
+void ShaderWatcher::run() {
+  if (!runInotify()) runPolling();
+}
+
+// Collects changed paths and hands them over once no event has arrived for
+// SHADER_WATCH_DEBOUNCE_MS, so a save that touches a file twice reloads once.
+class Debounce {
+  std::set<std::string> pending{};
+  Clock::time_point last{};
+
+  public:
+    void add(const std::string &path) {
+      pending.insert(path);
+      last = Clock::now();
+    }
+
+    template<typename F>
+    void flush(F &&deliver) {
+      if (pending.empty() || Clock::now() - last < std::chrono::milliseconds(SHADER_WATCH_DEBOUNCE_MS)) return;
+      for (auto &path : pending) deliver(path);
+      pending.clear();
+    }
+};
+
+bool ShaderWatcher::runInotify() {
+#ifdef __linux__
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) return false;
+
+  uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+  std::map<int, std::string> dirs;
+  auto add = [&](const std::string &dir) {
+    int wd = inotify_add_watch(fd, dir.c_str(), mask);
+    if (wd >= 0) dirs[wd] = dir;
+  };
+
+  std::error_code error;
+  add(root);
+  for (auto &entry : std::filesystem::recursive_directory_iterator(root, error)) {
+    if (entry.is_directory()) add(normalise(entry.path().string()));
+  }
+  if (dirs.empty()) {
+    close(fd);
+    return false;
+  }
+  spdlog::info("Shader watcher: inotify on {} directories below {}", dirs.size(), root);
+
+  Debounce debounce;
+  alignas(inotify_event) char buffer[4096];
+  while (!stopping) {
+    pollfd fds{.fd = fd, .events = POLLIN, .revents = 0};
+    if (::poll(&fds, 1, SHADER_WATCH_DEBOUNCE_MS / 2) > 0) {
+      ssize_t length;
+      while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *at = buffer; at < buffer + length; ) {
+          auto event = (const inotify_event *)at;
+          at += sizeof(inotify_event) + event->len;
+
+          auto dir = dirs.find(event->wd);
+          if (dir == dirs.end() || event->len == 0) continue;
+          auto path = dir->second + "/" + event->name;
+          if (event->mask & IN_ISDIR) {
+            if (event->mask & IN_CREATE) add(path);
+            continue;
+          }
+          if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) debounce.add(path);
+        }
+      }
+    }
+    debounce.flush([this](const std::string &path) { deliver(path); });
+  }
+
+  close(fd);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ShaderWatcher::runPolling() {
+  spdlog::info("Shader watcher: Scanning {} every {}ms", root, SHADER_WATCH_POLL_MS);
+
+  std::map<std::string, std::filesystem::file_time_type> times;
+  auto scan = [&](Debounce *debounce) {
+    std::error_code error;
+    for (auto &entry : std::filesystem::recursive_directory_iterator(root, error)) {
+      if (!entry.is_regular_file(error)) continue;
+      auto path = normalise(entry.path().string());
+      auto time = entry.last_write_time(error);
+      auto known = times.find(path);
+      if (known != times.end() && known->second == time) continue;
+      times[path] = time;
+      if (debounce) debounce->add(path);
+    }
+  };
+
+  Debounce debounce;
+  scan(nullptr);
+  auto next_scan = Clock::now();
+  while (!stopping) {
+    if (Clock::now() >= next_scan) {
+      scan(&debounce);
+      next_scan = Clock::now() + std::chrono::milliseconds(SHADER_WATCH_POLL_MS);
+    }
+    debounce.flush([this](const std::string &path) { deliver(path); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCH_DEBOUNCE_MS / 2));
+  }
+}
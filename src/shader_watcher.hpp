@@ -0,0 +1,70 @@
+#ifndef CSCI_4110U_SHADER_WATCHER_H
+#define CSCI_4110U_SHADER_WATCHER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#define SHADER_WATCH_DEBOUNCE_MS 100  // Quiet time before a burst of events is delivered.
+#define SHADER_WATCH_POLL_MS 250      // Scan interval without inotify.
+#define SHADER_WATCH_QUEUE 64
+
+// Single producer, single consumer ring buffer. Full pushes are dropped.
+template<typename T, size_t N>
+class SpscQueue {
+  std::array<T, N> slots{};
+  std::atomic<size_t> head{0};  // Next slot to pop, written by the consumer.
+  std::atomic<size_t> tail{0};  // Next slot to push, written by the producer.
+
+  public:
+    bool push(T value) {
+      size_t at = tail.load(std::memory_order_relaxed);
+      if (at - head.load(std::memory_order_acquire) == N) return false;
+      slots[at % N] = std::move(value);
+      tail.store(at + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T &value) {
+      size_t at = head.load(std::memory_order_relaxed);
+      if (at == tail.load(std::memory_order_acquire)) return false;
+      value = std::move(slots[at % N]);
+      head.store(at + 1, std::memory_order_release);
+      return true;
+    }
+};
+
+/* Watches every file below a directory from one thread.
+
+   Uses inotify where available (close after write and renames onto a path,
+   which covers editors that save through a temporary file), otherwise
+   compares modification times every SHADER_WATCH_POLL_MS. Events are
+   collected until the tree has been quiet for SHADER_WATCH_DEBOUNCE_MS, then
+   each changed path is delivered once. Paths are relative to the working
+   directory in generic form, e.g. "shaders/util/sdf.glsl".
+*/
+class ShaderWatcher {
+  std::string root{};
+  std::thread thread{};
+  std::atomic<bool> stopping{false};
+  SpscQueue<std::string, SHADER_WATCH_QUEUE> changed{};
+
+  void run();
+  bool runInotify();
+  void runPolling();
+  void deliver(const std::string &path);
+
+  public:
+    ~ShaderWatcher() { stop(); }
+
+    void start(const std::string &root);  // Does nothing if already running.
+    void stop();
+    bool running() const { return thread.joinable(); }
+    bool poll(std::string &path) { return changed.pop(path); }  // Render thread only.
+
+    static std::string normalise(const std::string &path);
+};
+
+#endif
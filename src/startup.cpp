@@ -0,0 +1,44 @@
+#include <spdlog/spdlog.h>
+
+#include "startup.hpp"
+
+double Startup::now() {
+  auto time = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double>(time).count();
+}
+
+// Static initialisation, as close to process start as we can get.
+double Startup::origin = Startup::now();
+double Startup::last = Startup::origin;
+bool Startup::first_present = false;
+bool Startup::scene_ready = false;
+bool Startup::done = false;
+double Startup::totals[STARTUP_CATEGORIES] = {};
+
+void Startup::mark(const char *what) {
+  if (done) return;
+
+  double time = now();
+  spdlog::info("Startup: {:8.2f}ms (+{:.2f}ms) {}", (time - origin) * 1000.0, (time - last) * 1000.0, what);
+  last = time;
+}
+
+void Startup::ready() {
+  scene_ready = true;
+}
+
+void Startup::present() {
+  if (done) return;
+
+  if (!first_present) {
+    first_present = true;
+    mark("First present");
+  }
+  if (!scene_ready) return;
+
+  mark("First scene frame");
+  spdlog::info("Startup: Shader reads {:.2f}ms, compile {:.2f}ms, link {:.2f}ms, binary loads {:.2f}ms",
+    totals[STARTUP_READ] * 1000.0, totals[STARTUP_COMPILE] * 1000.0,
+    totals[STARTUP_LINK] * 1000.0, totals[STARTUP_BINARY] * 1000.0);
+  done = true;
+}
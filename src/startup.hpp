@@ -0,0 +1,52 @@
+#ifndef CSCI_4110U_STARTUP_H
+#define CSCI_4110U_STARTUP_H
+
+#include <chrono>
+
+#define STARTUP_READ 0     // Shader file reads.
+#define STARTUP_COMPILE 1  // glCompileShader.
+#define STARTUP_LINK 2     // glLinkProgram and waiting on its status.
+#define STARTUP_BINARY 3   // Program cache loads.
+#define STARTUP_CATEGORIES 4
+
+/* Time to first frame, logged as it happens.
+
+   mark() logs a point on the timeline (GLFW init, GL loaded, ...) and
+   StartupScope adds to a category total. The timeline ends at the first
+   present after ready(), the first frame that shows the scene, with a
+   summary of the totals. Everything after that is a branch.
+*/
+class Startup {
+  static double origin;
+  static double last;
+  static bool first_present;
+  static bool scene_ready;
+  static bool done;
+  static double totals[STARTUP_CATEGORIES];
+
+  static double now();
+
+  public:
+    static bool active() { return !done; }
+    static void mark(const char *what);
+    static void add(int category, double seconds) { totals[category] += seconds; }
+    static void ready();    // The frame being drawn shows the scene.
+    static void present();  // Call after every swap.
+};
+
+class StartupScope {
+  int category;
+  std::chrono::steady_clock::time_point start{};
+
+  public:
+    StartupScope(int category) : category(category) {
+      if (Startup::active()) start = std::chrono::steady_clock::now();
+    }
+
+    ~StartupScope() {
+      if (!Startup::active()) return;
+      Startup::add(category, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+#endif
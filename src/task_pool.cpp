@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+
+#include "task_pool.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Which pool and worker the current thread belongs to.
+static thread_local const TaskPool *current_pool = nullptr;
+static thread_local int current_worker = 0;
+
+TaskPool::TaskPool(int size) {
+  if (size <= 0) size = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 0; i < size; i++) workers.push_back(std::make_unique<Worker>());
+  for (int i = 1; i < size; i++) threads.emplace_back(&TaskPool::workerLoop, this, i);
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard lock{sleep_mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads) thread.join();
+}
+
+int TaskPool::currentWorker() const {
+  return current_pool == this ? current_worker : 0;
+}
+
+void TaskPool::run(TaskGroup &group, std::function<void()> task) {
+  group.pending.fetch_add(1, std::memory_order_relaxed);
+
+  Worker &worker = *workers[currentWorker()];
+  {
+    std::lock_guard lock{worker.mutex};
+    worker.tasks.push_back(Task{.run = std::move(task), .group = &group});
+  }
+  queued.fetch_add(1, std::memory_order_release);
+
+  // Taking the lock orders this against a worker that is about to sleep.
+  { std::lock_guard lock{sleep_mutex}; }
+  wake.notify_one();
+}
+
+bool TaskPool::pop(int worker, Task &task) {
+  Worker &own = *workers[worker];
+  std::lock_guard lock{own.mutex};
+  if (own.tasks.empty()) return false;
+
+  task = std::move(own.tasks.back());
+  own.tasks.pop_back();
+  return true;
+}
+
+bool TaskPool::steal(int worker, Task &task) {
+  for (int i = 1; i < size(); i++) {
+    Worker &victim = *workers[(worker + i) % size()];
+    std::lock_guard lock{victim.mutex};
+    if (victim.tasks.empty()) continue;
+
+    task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    workers[worker]->steal_count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+bool TaskPool::runOne(int worker) {
+  if (queued.load(std::memory_order_acquire) == 0) return false;
+
+  Task task;
+  if (!pop(worker, task) && !steal(worker, task)) return false;
+  queued.fetch_sub(1, std::memory_order_relaxed);
+
+  // Tasks added by this one go to this worker's deque.
+  const TaskPool *outer_pool = current_pool;
+  int outer_worker = current_worker;
+  current_pool = this;
+  current_worker = worker;
+
+  auto start = Clock::now();
+  task.run();
+  Worker &own = *workers[worker];
+  own.busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(),
+                        std::memory_order_relaxed);
+  own.run_count.fetch_add(1, std::memory_order_relaxed);
+
+  current_pool = outer_pool;
+  current_worker = outer_worker;
+  task.group->pending.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void TaskPool::workerLoop(int worker) {
+  current_pool = this;
+  current_worker = worker;
+
+  while (true) {
+    if (runOne(worker)) continue;
+
+    std::unique_lock lock{sleep_mutex};
+    wake.wait(lock, [&]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+    if (stopping) return;
+  }
+}
+
+void TaskPool::wait(TaskGroup &group) {
+  int worker = currentWorker();
+  while (!group.done()) {
+    // Nothing left to take, the group's last tasks are running elsewhere.
+    if (!runOne(worker)) std::this_thread::yield();
+  }
+}
+
+void TaskPool::parallelFor2D(int width, int height, int tile_w, int tile_h,
+                             const std::function<void(int x0, int y0, int x1, int y1)> &body) {
+  int tiles_x = (width + tile_w - 1) / tile_w;
+  int tiles_y = (height + tile_h - 1) / tile_h;
+  if (tiles_x <= 0 || tiles_y <= 0) return;
+
+  TaskGroup group;
+  // Tiles [first, last) in row order. The upper half goes to the deque for
+  // others to steal until one tile is left, which this task runs.
+  std::function<void(int, int)> split = [&](int first, int last) {
+    while (last - first > 1) {
+      int middle = first + (last - first) / 2;
+      run(group, [&split, middle, last]() { split(middle, last); });
+      last = middle;
+    }
+    int x0 = (first % tiles_x) * tile_w;
+    int y0 = (first / tiles_x) * tile_h;
+    body(x0, y0, std::min(x0 + tile_w, width), std::min(y0 + tile_h, height));
+  };
+
+  run(group, [&]() { split(0, tiles_x * tiles_y); });
+  wait(group);
+}
+
+std::vector<TaskWorkerStats> TaskPool::stats() const {
+  std::vector<TaskWorkerStats> result;
+  for (auto &worker : workers) {
+    result.push_back(TaskWorkerStats{
+      .tasks = worker->run_count.load(std::memory_order_relaxed),
+      .steals = worker->steal_count.load(std::memory_order_relaxed),
+      .busy_ms = worker->busy_ns.load(std::memory_order_relaxed) / 1e6,
+    });
+  }
+  return result;
+}
+
+void TaskPool::resetStats() {
+  for (auto &worker : workers) {
+    worker->run_count = 0;
+    worker->steal_count = 0;
+    worker->busy_ns = 0;
+  }
+}
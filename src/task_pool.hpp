@@ -0,0 +1,94 @@
+#ifndef CSCI_4110U_TASK_POOL_H
+#define CSCI_4110U_TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks that can be waited on together. Must outlive its tasks.
+class TaskGroup {
+  std::atomic<int> pending{0};
+  friend class TaskPool;
+
+  public:
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// What one worker did since the last resetStats().
+struct TaskWorkerStats {
+  int tasks = 0;        // Run, stolen or not.
+  int steals = 0;       // Taken from another worker's deque.
+  double busy_ms = 0.0;
+};
+
+/* Work stealing thread pool.
+
+   Every worker owns a deque. Tasks a worker adds go to the back of its own
+   deque and it takes them back from there, newest first while they are
+   still in cache. A worker with nothing left steals the oldest task from
+   the front of another's, which for a recursively split range is the
+   biggest piece left. Idle workers sleep until a task is added.
+
+   A pool of N runs N-1 threads. The Nth worker is whichever thread waits
+   on a group: wait() runs tasks until the group is done instead of
+   blocking, so waiting from inside a task can not deadlock. Threads that
+   are not workers share worker 0's deque.
+*/
+class TaskPool {
+  struct Task {
+    std::function<void()> run;
+    TaskGroup *group;
+  };
+
+  struct Worker {
+    std::mutex mutex{};
+    std::deque<Task> tasks{};
+    std::atomic<int> run_count{0};
+    std::atomic<int> steal_count{0};
+    std::atomic<int64_t> busy_ns{0};
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers{};
+  std::vector<std::thread> threads{};
+  std::atomic<int> queued{0};  // Tasks in every deque.
+  std::mutex sleep_mutex{};
+  std::condition_variable wake{};
+  bool stopping = false;  // Guarded by sleep_mutex.
+
+  int currentWorker() const;
+  bool pop(int worker, Task &task);
+  bool steal(int worker, Task &task);
+  bool runOne(int worker);
+  void workerLoop(int worker);
+
+  public:
+    explicit TaskPool(int size = 0);  // 0 for every core.
+    ~TaskPool();
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    int size() const { return workers.size(); }
+
+    void run(TaskGroup &group, std::function<void()> task);
+    void wait(TaskGroup &group);
+
+    /* Calls body(x0, y0, x1, y1) for every tile_w by tile_h tile of a
+       width by height grid, the last row and column clipped, and returns
+       when all are done. The tiles are split in halves as workers steal
+       them, neighbouring tiles mostly end up on the same worker.
+    */
+    void parallelFor2D(int width, int height, int tile_w, int tile_h,
+                       const std::function<void(int x0, int y0, int x1, int y1)> &body);
+
+    std::vector<TaskWorkerStats> stats() const;
+    void resetStats();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <fstream>
+
+#include <GL/gl.h>
+#include <spdlog/spdlog.h>
+
+#include "trace.hpp"
+
+#define TRACK_CPU 1
+#define TRACK_GPU 2
+
+bool Trace::recording = false;
+std::string Trace::path{};
+double Trace::origin = 0.0;
+bool Trace::gpu_synced = false;
+double Trace::gpu_offset = 0.0;
+std::vector<Trace::Event> Trace::events{};
+std::vector<Trace::Open> Trace::open{};
+
+double Trace::now() {
+  auto time = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double, std::micro>(time).count() - origin;
+}
+
+void Trace::add(Event event) {
+  if (events.size() == MAX_EVENTS) {
+    spdlog::warn("Trace: {} events recorded, dropping the rest", MAX_EVENTS);
+  }
+  if (events.size() >= MAX_EVENTS) return;
+
+  events.push_back(std::move(event));
+}
+
+void Trace::start(const std::string &trace_path) {
+  path = trace_path;
+  origin = 0.0;
+  origin = now();
+  gpu_synced = false;
+  events.clear();
+  events.reserve(1 << 16);
+  recording = true;
+  spdlog::info("Trace: Recording to {}", path);
+}
+
+void Trace::begin(const std::string &name) {
+  open.push_back({.name = name, .start = now()});
+}
+
+void Trace::end() {
+  if (open.empty()) return;
+
+  auto &scope = open.back();
+  add({.name = std::move(scope.name), .start = scope.start, .duration = now() - scope.start, .track = TRACK_CPU});
+  open.pop_back();
+}
+
+void Trace::gpu(const std::string &name, uint64_t start_ns, uint64_t end_ns) {
+  if (!recording) return;
+
+  if (!gpu_synced) {
+    // GL_TIMESTAMP reads the GPU clock without waiting, use it to line the
+    // GPU clock up with the CPU one.
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    gpu_offset = now() - gpu_now / 1.0e3;
+    gpu_synced = true;
+  }
+
+  add({
+    .name = name,
+    .start = start_ns / 1.0e3 + gpu_offset,
+    .duration = (end_ns - start_ns) / 1.0e3,
+    .track = TRACK_GPU,
+  });
+}
+
+static void writeEscaped(std::ofstream &out, const std::string &str) {
+  for (char c : str) {
+    if (c == '"' || c == '\\') out << '\\';
+    out << c;
+  }
+}
+
+void Trace::stop() {
+  if (!recording) return;
+  recording = false;
+  while (!open.empty()) end();
+
+  std::ofstream out{path};
+  if (!out) {
+    spdlog::error("Trace: Could not open {} for writing!", path);
+    return;
+  }
+
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+      << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << TRACK_CPU << ", \"args\": {\"name\": \"CPU\"}},\n"
+      << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << TRACK_GPU << ", \"args\": {\"name\": \"GPU\"}}";
+  out.precision(3);
+  out << std::fixed;
+  for (auto &event : events) {
+    out << ",\n{\"name\": \"";
+    writeEscaped(out, event.name);
+    out << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.track
+        << ", \"ts\": " << event.start << ", \"dur\": " << event.duration << "}";
+  }
+  out << "\n]}\n";
+
+  spdlog::info("Trace: {} events -> {}", events.size(), path);
+  events.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef CSCI_4110U_TRACE_H
+#define CSCI_4110U_TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Frame timeline in the Chrome trace event format (open the file in
+   ui.perfetto.dev or about://tracing).
+
+   CPU work is recorded with TraceScope, GPU passes come from GpuTimer's
+   timestamps and are placed on their own track, shifted onto the CPU clock.
+   Nothing is recorded until Trace::start, a scope then only costs a branch.
+*/
+class Trace {
+  static constexpr size_t MAX_EVENTS = 1 << 20;
+
+  struct Event {
+    std::string name;
+    double start;     // Microseconds since the trace started.
+    double duration;
+    int track;
+  };
+
+  struct Open {
+    std::string name;
+    double start;
+  };
+
+  static bool recording;
+  static std::string path;
+  static double origin;               // Seconds, steady clock.
+  static bool gpu_synced;
+  static double gpu_offset;           // Microseconds, CPU - GPU.
+  static std::vector<Event> events;
+  static std::vector<Open> open;
+
+  static double now();
+  static void add(Event event);
+
+  public:
+    static void start(const std::string &path);
+    static void stop();  // Writes the file.
+    static bool active() { return recording; }
+
+    static void begin(const std::string &name);
+    static void end();
+    static void gpu(const std::string &name, uint64_t start_ns, uint64_t end_ns);
+};
+
+struct TraceScope {
+  bool active;
+
+  TraceScope(const char *name) : active(Trace::active()) { if (active) Trace::begin(name); }
+  TraceScope(const std::string &name) : active(Trace::active()) { if (active) Trace::begin(name); }
+  ~TraceScope() { if (active) Trace::end(); }
+};
+
+#endif
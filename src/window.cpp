@@ -1,14 +1,29 @@
+#include <chrono>
+#include <cstring>
+#include <regex>
 #include <stdexcept>
 
+#ifdef CSCI_4110U_HEADLESS
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 #include <spdlog/spdlog.h>
 
+#include "gl_capture.hpp"
 #include "gl_errors.hpp"
+#include "startup.hpp"
+#include "trace.hpp"
 #include "window.hpp"
 
 void Window::logError(int error_code, const char *description) {
   spdlog::info("GLFW: {}", description);
 }
 
+void Window::glClearErrors(const char *, GLADapiproc, int, ...) {
+  glad_glGetError();
+}
+
 void Window::glError(void *ret, const char *name, GLADapiproc proc, int len_args, ...) {
   GLenum error = glad_glGetError();
   if (error == GL_NO_ERROR) return;
@@ -16,6 +31,34 @@ void Window::glError(void *ret, const char *name, GLADapiproc proc, int len_args
   spdlog::error("{}[{}]: {}", name, getGLErrorCodeString(error), getGLErrorString(name, error));
 }
 
+void GLAD_API_PTR Window::glDebugMessage(GLenum, GLenum type, GLuint, GLenum severity,
+                                         GLsizei length, const GLchar *message, const void *) {
+  std::string text{message, length < 0 ? std::strlen(message) : (size_t)length};
+  if (type != GL_DEBUG_TYPE_ERROR) {
+    if (severity == GL_DEBUG_SEVERITY_HIGH) {
+      spdlog::error("GL: {}", text);
+    } else if (severity == GL_DEBUG_SEVERITY_MEDIUM) {
+      spdlog::warn("GL: {}", text);
+    } else {
+      spdlog::info("GL: {}", text);
+    }
+    return;
+  }
+
+  // Drivers usually name the error and the call, e.g. Mesa's
+  // "GL_INVALID_ENUM in glEnable(invalid)", give the same message as glError.
+  static const std::regex call{R"(\b(gl[A-Z]\w*))"};
+  std::smatch match;
+  std::string name = std::regex_search(text, match, call) ? match[1].str() : "unknown";
+  for (auto &[code, code_name] : gl_error_codes) {
+    if (code == GL_NO_ERROR || text.find(code_name) == std::string::npos) continue;
+
+    spdlog::error("{}[{}]: {} ({})", name, code_name, getGLErrorString(name.c_str(), code), text);
+    return;
+  }
+  spdlog::error("GL: {}", text);
+}
+
 void Window::glfwKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
   auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
   if (!win) {
@@ -26,16 +69,148 @@ void Window::glfwKeyCallback(GLFWwindow *window, int key, int scancode, int acti
   win->handleInput(key, action);
 }
 
+#ifdef CSCI_4110U_HEADLESS
+void Window::createHeadlessContext(const WindowOpts &opts) {
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  auto queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLint major, minor;
+
+  // Prefer a real GPU (render node), fall back to Mesa's surfaceless platform
+  // which also covers software rasterisers such as llvmpipe.
+  if (getPlatformDisplay && queryDevices) {
+    EGLDeviceEXT device;
+    EGLint num_devices = 0;
+    if (queryDevices(1, &device, &num_devices) && num_devices > 0) {
+      display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+      if (display != EGL_NO_DISPLAY && !eglInitialize(display, &major, &minor)) {
+        display = EGL_NO_DISPLAY;
+      }
+    }
+  }
+  if (display == EGL_NO_DISPLAY && getPlatformDisplay) {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY && !eglInitialize(display, &major, &minor)) {
+      display = EGL_NO_DISPLAY;
+    }
+  }
+  if (display == EGL_NO_DISPLAY) {
+    spdlog::error("EGL: No headless display available!");
+    throw std::runtime_error("eglInitialize");
+  }
+  egl_display = display;
+  Startup::mark("eglInitialize");
+  spdlog::info("EGL: {}.{} {}", major, minor, eglQueryString(display, EGL_VENDOR));
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    spdlog::error("EGL: OpenGL API not supported!");
+    throw std::runtime_error("eglBindAPI");
+  }
+
+  const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE,        8,
+    EGL_GREEN_SIZE,      8,
+    EGL_BLUE_SIZE,       8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+    spdlog::error("EGL: No matching config!");
+    throw std::runtime_error("eglChooseConfig");
+  }
+
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION,       opts.glMajor,
+    EGL_CONTEXT_MINOR_VERSION,       opts.glMinor,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, opts.glProfile == GLFW_OPENGL_CORE_PROFILE
+                                       ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT
+                                       : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_CONTEXT_OPENGL_DEBUG,        opts.debug_context || opts.gl_errors == GL_ERRORS_DEBUG_OUTPUT,
+    EGL_NONE
+  };
+  egl_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if (egl_context == EGL_NO_CONTEXT) {
+    spdlog::error("EGL: Could not create a {}.{} context!", opts.glMajor, opts.glMinor);
+    throw std::runtime_error("eglCreateContext");
+  }
+
+  // Requires EGL_KHR_surfaceless_context, all rendering goes to `default_fbo`.
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+    spdlog::error("EGL: Surfaceless contexts not supported!");
+    throw std::runtime_error("eglMakeCurrent");
+  }
+
+  if (!gladLoadGL(eglGetProcAddress)) {
+    throw std::runtime_error("gladLoadGL");
+  }
+  Startup::mark("EGL context, GL loaded");
+}
+
+void Window::destroyHeadlessContext() {
+  if (!egl_display) return;
+
+  eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (egl_context) eglDestroyContext(egl_display, egl_context);
+  eglTerminate(egl_display);
+  egl_context = nullptr;
+  egl_display = nullptr;
+}
+#else
+void Window::createHeadlessContext(const WindowOpts &) {
+  spdlog::error("Headless rendering requires building with EGL (meson option `headless`)!");
+  throw std::runtime_error("headless");
+}
+
+void Window::destroyHeadlessContext() {}
+#endif
+
+void Window::createDefaultFramebuffer(const WindowOpts &opts) {
+  glGenRenderbuffers(1, &default_colour);
+  glBindRenderbuffer(GL_RENDERBUFFER, default_colour);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, opts.width, opts.height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &default_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, default_fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, default_colour);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    spdlog::critical("glCheckFramebufferStatus: Default framebuffer is incomplete!");
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 Window::Window(WindowOpts opts) {
+  headless = opts.headless;
+  gl_capture = opts.gl_capture;
+  gl_capture_frames = opts.gl_capture_frames;
+
+  if (headless) {
+    try {
+      createHeadlessContext(opts);
+    } catch (std::runtime_error &err) {
+      destroyHeadlessContext();
+      throw;
+    }
+
+    setGLErrors(opts.gl_errors);
+    createDefaultFramebuffer(opts);
+    return;
+  }
+
   glfwSetErrorCallback(Window::logError);
 
   if (!glfwInit()) {
     throw std::runtime_error("glfwInit");
   }
+  Startup::mark("glfwInit");
 
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, opts.glMajor);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, opts.glMinor);
   glfwWindowHint(GLFW_OPENGL_PROFILE, opts.glProfile);
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, opts.debug_context || opts.gl_errors == GL_ERRORS_DEBUG_OUTPUT);
 
   ptr = glfwCreateWindow(
     opts.width,
@@ -50,6 +225,7 @@ Window::Window(WindowOpts opts) {
     throw std::runtime_error("glfwCreateWindow");
   }
 
+  Startup::mark("glfwCreateWindow");
   glfwSetKeyCallback(ptr, glfwKeyCallback);
   glfwMakeContextCurrent(ptr);
 
@@ -58,23 +234,108 @@ Window::Window(WindowOpts opts) {
     glfwTerminate();
     throw std::runtime_error("gladLoadGL");
   }
+  Startup::mark("GL loaded");
 
-  gladSetGLPostCallback(&glError);
+  setGLErrors(opts.gl_errors);
 
-  glfwSwapInterval(1);
+  glfwSwapInterval(opts.vsync ? 1 : 0);
 }
 
 Window::~Window() {
+  if (headless) {
+    glDeleteFramebuffers(1, &default_fbo);
+    glDeleteRenderbuffers(1, &default_colour);
+    destroyHeadlessContext();
+    return;
+  }
+
   glfwDestroyWindow(ptr);
   glfwTerminate();
 }
 
+double Window::getTime() const {
+  if (headless) {
+    // glfwGetTime requires glfwInit, which fails without a display.
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(now).count();
+  }
+
+  return glfwGetTime();
+}
+
+// Can be switched at any time, e.g. to compare the modes in one benchmark.
+// Returns the mode in use.
+int Window::setGLErrors(int mode) {
+  if (mode == GL_ERRORS_DEBUG_OUTPUT && !GLAD_GL_VERSION_4_3) {
+    spdlog::warn("GL debug output requires OpenGL 4.3, checking errors with glGetError instead.");
+    mode = GL_ERRORS_POLL;
+  }
+
+  if (GlCapture::active()) {
+    gladInstallGLDebug();
+    GlCapture::install(mode == GL_ERRORS_POLL ? &glError : nullptr);
+  } else if (mode == GL_ERRORS_POLL) {
+    gladInstallGLDebug();
+    gladSetGLPreCallback(&glClearErrors);
+    gladSetGLPostCallback(&glError);
+  } else {
+    // Calls go straight to the driver, no wrapper and no glGetError.
+    gladUninstallGLDebug();
+  }
+
+  if (GLAD_GL_VERSION_4_3) {
+    if (mode == GL_ERRORS_DEBUG_OUTPUT) {
+      // Synchronous so that messages arrive inside the offending call.
+      glEnable(GL_DEBUG_OUTPUT);
+      glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+      glDebugMessageCallback(glDebugMessage, nullptr);
+      glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+    } else {
+      glDisable(GL_DEBUG_OUTPUT);
+      glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+  }
+
+  gl_errors = mode;
+  return mode;
+}
+
+void Window::close() {
+  should_close = true;
+  if (ptr) glfwSetWindowShouldClose(ptr, GLFW_TRUE);
+}
+
 void Window::run() {
+  if (!gl_capture.empty()) {
+    // Started here so that only frames are captured, not start up.
+    GlCapture::start(gl_capture, gl_capture_frames);
+    setGLErrors(gl_errors);
+  }
+
+  if (headless) {
+    while (!should_close) {
+      TraceScope frame{"Frame"};
+      draw();
+      TraceScope flush{"glFlush"};
+      glFlush();
+      Startup::present();
+      if (GlCapture::endFrame()) setGLErrors(gl_errors);
+    }
+    return;
+  }
+
   while (!glfwWindowShouldClose(ptr)) {
-    glfwPollEvents();
+    TraceScope frame{"Frame"};
+    {
+      TraceScope scope{"glfwPollEvents"};
+      glfwPollEvents();
+    }
 
     draw();
 
+    TraceScope scope{"glfwSwapBuffers"};
     glfwSwapBuffers(ptr);
+    Startup::present();
+    if (GlCapture::endFrame()) setGLErrors(gl_errors);
   }
 }
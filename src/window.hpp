@@ -4,6 +4,16 @@
 #define GLFW_INCLUDE_NONE
 #include <GL/gl.h>
 #include <GLFW/glfw3.h>
+#include <string>
+
+#define GL_ERRORS_OFF 0
+#define GL_ERRORS_POLL 1          // glGetError around every call (glad debug wrappers).
+#define GL_ERRORS_DEBUG_OUTPUT 2  // KHR_debug callback, requires GL 4.3.
+
+// Set by the `gl_errors` meson option.
+#ifndef CSCI_4110U_GL_ERRORS
+#define CSCI_4110U_GL_ERRORS GL_ERRORS_POLL
+#endif
 
 struct WindowOpts {
   /* Window Opts */
@@ -11,25 +21,62 @@ struct WindowOpts {
   int height;
   const char *title;
 
+  /* Surface */
+  // Render offscreen without a display server. The context comes from EGL
+  // (a GPU device when one is available, otherwise Mesa's surfaceless
+  // platform, e.g. llvmpipe) and `default_fbo` stands in for the window.
+  bool headless = false;
+  bool vsync = true;
+  int gl_errors = CSCI_4110U_GL_ERRORS;
+  // Binary trace of every GL call in the first frames, see gl_capture.hpp.
+  std::string gl_capture{};
+  int gl_capture_frames = 10;
+
   /* GL Context */
   int glMajor = 3;
   int glMinor = 3;
   int glProfile = GLFW_OPENGL_CORE_PROFILE;
+  // Debug context even when starting in another gl_errors mode.
+  bool debug_context = false;
 };
 
 class Window {
   static void logError(int error_code, const char *description);
+  static void glClearErrors(const char *name, GLADapiproc proc, int len_args, ...);
   static void glError(void *ret, const char *name, GLADapiproc proc, int len_args, ...);
+  static void GLAD_API_PTR glDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                          GLsizei length, const GLchar *message, const void *user);
   static void glfwKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
+  // Headless state. EGL types are kept opaque so that this header does not
+  // depend on EGL (it is not available on every platform).
+  void *egl_display = nullptr;
+  void *egl_context = nullptr;
+  GLuint default_colour = 0;
+  bool should_close = false;
+  std::string gl_capture;
+  int gl_capture_frames;
+
+  void createHeadlessContext(const WindowOpts &opts);
+  void createDefaultFramebuffer(const WindowOpts &opts);
+  void destroyHeadlessContext();
+
   protected:
-    GLFWwindow *ptr = nullptr;
+    GLFWwindow *ptr = nullptr;   // nullptr when headless.
+    bool headless = false;
+    GLuint default_fbo = 0;      // Framebuffer to present to, 0 unless headless.
 
     Window();
     Window(WindowOpts opts);
 
+    int gl_errors = GL_ERRORS_OFF;
+
+    double getTime() const;
+    void close();
+    int setGLErrors(int mode);
+
   public:
-    ~Window();
+    virtual ~Window();
     void run();
     virtual void handleInput(int key, int action) = 0;
     virtual void draw() = 0;